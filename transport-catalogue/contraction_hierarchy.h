@@ -0,0 +1,623 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "transport_catalogue.pb.h"
+
+namespace graph {
+
+/*
+ * Иерархия сжатия (Contraction Hierarchies) поверх DirectedWeightedGraph.
+ * При построении вершины по очереди "сжимаются", а кратчайшие пути через сжатую вершину
+ * заменяются рёбрами-ярлыками. Ярлык хранит два ребра, которые он заменяет, поэтому
+ * любой найденный путь разворачивается обратно в исходные рёбра графа.
+ * Запрос - двунаправленный поиск Дейкстры только вверх по иерархии.
+ * Идентификаторы рёбер иерархии: [0, E) - исходные рёбра графа, [E, E + S) - ярлыки.
+ */
+    template <typename Weight>
+    class ContractionHierarchy {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+    public:
+        struct Route {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        explicit ContractionHierarchy(const Graph& graph);
+        // restored_edge_ids - новые номера рёбер графа, если он перенумеровал их при загрузке (restored_edge_ids[старый] = новый)
+        ContractionHierarchy(const Graph& graph, const tc_serialize::TransportCatalogue& tc_,
+                             const std::vector<EdgeId>& restored_edge_ids = {});
+
+        bool SaveTo(tc_serialize::TransportCatalogue& tc_to) const;
+        // Бросает std::logic_error, если сохранённые данные не подходят к графу
+        bool RestoreFrom(const tc_serialize::TransportCatalogue& tc_from, const std::vector<EdgeId>& restored_edge_ids = {});
+
+        std::optional<Route> BuildRoute(VertexId from, VertexId to) const;
+        // Кратчайший маршрут от любой из точек from до любой из to, вес включает веса точек
+        std::optional<Route> BuildRoute(const std::vector<RouteEndpoint<Weight>>& from,
+                                        const std::vector<RouteEndpoint<Weight>>& to) const;
+        // Веса кратчайших путей from[i] -> to[j] по строкам (пусто - пути нет), без восстановления рёбер
+        std::vector<std::optional<Weight>> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+        size_t GetShortcutCount() const;
+
+    private:
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        // Ребро поискового графа. В графе "вверх" head - вершина с большим рангом, куда ведёт ребро,
+        // в графе "вниз" ребро хранится развёрнутым: head - вершина с большим рангом, откуда оно выходит
+        struct Arc {
+            VertexId head;
+            Weight weight;
+            EdgeId edge;
+        };
+
+        struct Label {
+            Weight weight;
+            std::optional<EdgeId> edge;
+        };
+
+        class Contractor;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        std::vector<uint32_t> ranks_;
+        std::vector<Shortcut> shortcuts_;
+        std::vector<size_t> up_offsets_;
+        std::vector<Arc> up_arcs_;
+        std::vector<size_t> down_offsets_;
+        std::vector<Arc> down_arcs_;
+
+        VertexId GetEdgeFrom(EdgeId edge) const;
+        VertexId GetEdgeTo(EdgeId edge) const;
+        Weight GetEdgeWeight(EdgeId edge) const;
+        void BuildSearchGraphs();
+        void UnpackEdge(EdgeId edge, std::vector<EdgeId>& edges) const;
+        void SearchUpward(VertexId start, bool forward, std::vector<std::optional<Weight>>& labels,
+                          std::vector<std::pair<VertexId, Weight>>& settled) const;
+        static void FillSearchGraph(std::vector<std::vector<Arc>>& lists, std::vector<size_t>& offsets, std::vector<Arc>& arcs);
+    };
+
+/*
+ * Состояние, нужное только во время построения иерархии: рабочий граф из ещё не сжатых вершин
+ * и структуры для локального поиска "свидетелей" - путей, делающих ярлык ненужным.
+ */
+    template <typename Weight>
+    class ContractionHierarchy<Weight>::Contractor {
+    public:
+        explicit Contractor(ContractionHierarchy& ch)
+                : ch_(ch)
+                , vertex_count_(ch.graph_.GetVertexCount())
+                , out_(vertex_count_)
+                , in_(vertex_count_)
+                , contracted_(vertex_count_, false)
+                , deleted_neighbours_(vertex_count_, 0)
+                , witness_weight_(vertex_count_, ZERO_WEIGHT)
+                , witness_mark_(vertex_count_, 0)
+                , target_limit_(vertex_count_, ZERO_WEIGHT)
+                , target_mark_(vertex_count_, 0) {
+            const Graph& graph = ch_.graph_;
+            std::vector<EdgeId> edge_ids;
+            edge_ids.reserve(graph.GetEdgeCount());
+            for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+                const auto& edge = graph.GetEdge(edge_id);
+                if (edge.weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                if (edge.from != edge.to) {
+                    edge_ids.push_back(edge_id);
+                }
+            }
+            // из параллельных рёбер в рабочий граф попадает только самое лёгкое
+            std::sort(edge_ids.begin(), edge_ids.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+                const auto& l = graph.GetEdge(lhs);
+                const auto& r = graph.GetEdge(rhs);
+                return std::tie(l.from, l.to, l.weight, lhs) < std::tie(r.from, r.to, r.weight, rhs);
+            });
+            for (size_t i = 0; i < edge_ids.size(); ++i) {
+                const auto& edge = graph.GetEdge(edge_ids[i]);
+                if (i > 0) {
+                    const auto& prev = graph.GetEdge(edge_ids[i - 1]);
+                    if (prev.from == edge.from && prev.to == edge.to) {
+                        continue;
+                    }
+                }
+                out_[edge.from].push_back({edge.to, edge.weight, edge_ids[i]});
+                in_[edge.to].push_back({edge.from, edge.weight, edge_ids[i]});
+            }
+        }
+
+        void Run() {
+            using QueueItem = std::pair<int, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                queue.emplace(ComputePriority(vertex), vertex);
+            }
+            ch_.ranks_.assign(vertex_count_, 0);
+            uint32_t rank = 0;
+            while (!queue.empty()) {
+                const VertexId vertex = queue.top().second;
+                queue.pop();
+                if (contracted_[vertex]) {
+                    continue;
+                }
+                // ленивое обновление: приоритет мог вырасти после сжатия соседей
+                const int priority = ComputePriority(vertex);
+                if (!queue.empty() && priority > queue.top().first) {
+                    queue.emplace(priority, vertex);
+                    continue;
+                }
+                ContractVertex(vertex, false);
+                contracted_[vertex] = true;
+                ch_.ranks_[vertex] = rank++;
+                for (const auto& edge : out_[vertex]) {
+                    ++deleted_neighbours_[edge.other];
+                }
+                for (const auto& edge : in_[vertex]) {
+                    ++deleted_neighbours_[edge.other];
+                }
+            }
+        }
+
+    private:
+        struct WorkingEdge {
+            VertexId other;
+            Weight weight;
+            EdgeId edge;
+        };
+
+        // при оценке приоритета поиск свидетелей грубее: лишний ярлык лишь ухудшает оценку, но не корректность
+        static constexpr size_t MAX_WITNESS_SETTLED_SIMULATION = 50;
+        static constexpr size_t MAX_WITNESS_SETTLED = 500;
+
+        ContractionHierarchy& ch_;
+        size_t vertex_count_;
+        std::vector<std::vector<WorkingEdge>> out_;
+        std::vector<std::vector<WorkingEdge>> in_;
+        std::vector<bool> contracted_;
+        std::vector<int> deleted_neighbours_;
+        std::vector<Weight> witness_weight_;
+        std::vector<uint32_t> witness_mark_;
+        std::vector<Weight> target_limit_;
+        std::vector<uint32_t> target_mark_;
+        uint32_t current_mark_ = 0;
+
+        int ComputePriority(VertexId vertex) {
+            int edges_removed = 0;
+            for (const auto& edge : in_[vertex]) {
+                edges_removed += contracted_[edge.other] ? 0 : 1;
+            }
+            for (const auto& edge : out_[vertex]) {
+                edges_removed += contracted_[edge.other] ? 0 : 1;
+            }
+            const int shortcuts = static_cast<int>(ContractVertex(vertex, true));
+            return shortcuts - edges_removed + deleted_neighbours_[vertex];
+        }
+
+        // Возвращает число ярлыков, которые нужны при сжатии вершины; при simulate == false добавляет их
+        size_t ContractVertex(VertexId vertex, bool simulate) {
+            std::vector<WorkingEdge> ins;
+            std::vector<WorkingEdge> outs;
+            for (const auto& edge : in_[vertex]) {
+                if (!contracted_[edge.other]) {
+                    ins.push_back(edge);
+                }
+            }
+            for (const auto& edge : out_[vertex]) {
+                if (!contracted_[edge.other]) {
+                    outs.push_back(edge);
+                }
+            }
+            if (ins.empty() || outs.empty()) {
+                return 0;
+            }
+            size_t shortcut_count = 0;
+            for (const auto& in_edge : ins) {
+                RunWitnessSearch(in_edge, vertex, outs, simulate ? MAX_WITNESS_SETTLED_SIMULATION : MAX_WITNESS_SETTLED);
+                for (const auto& out_edge : outs) {
+                    if (out_edge.other == in_edge.other) {
+                        continue;
+                    }
+                    const Weight weight = in_edge.weight + out_edge.weight;
+                    if (witness_mark_[out_edge.other] == current_mark_ && !(weight < witness_weight_[out_edge.other])) {
+                        continue;
+                    }
+                    ++shortcut_count;
+                    if (!simulate) {
+                        const EdgeId shortcut_id = ch_.graph_.GetEdgeCount() + ch_.shortcuts_.size();
+                        ch_.shortcuts_.push_back({in_edge.other, out_edge.other, weight, in_edge.edge, out_edge.edge});
+                        out_[in_edge.other].push_back({out_edge.other, weight, shortcut_id});
+                        in_[out_edge.other].push_back({in_edge.other, weight, shortcut_id});
+                    }
+                }
+            }
+            return shortcut_count;
+        }
+
+        // Дейкстра от начала входящего ребра в рабочем графе без вершины excluded. Останавливается, когда
+        // для всех концов исходящих рёбер найден путь не длиннее пути через excluded, либо по весу и числу вершин
+        void RunWitnessSearch(const WorkingEdge& in_edge, VertexId excluded, const std::vector<WorkingEdge>& outs,
+                              size_t max_settled) {
+            using QueueItem = std::pair<Weight, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+            ++current_mark_;
+            Weight max_weight = ZERO_WEIGHT;
+            size_t unresolved = 0;
+            for (const auto& out_edge : outs) {
+                const Weight limit = in_edge.weight + out_edge.weight;
+                max_weight = std::max(max_weight, limit);
+                if (out_edge.other != in_edge.other && target_mark_[out_edge.other] != current_mark_) {
+                    target_mark_[out_edge.other] = current_mark_;
+                    target_limit_[out_edge.other] = limit;
+                    ++unresolved;
+                }
+            }
+            const VertexId source = in_edge.other;
+            witness_mark_[source] = current_mark_;
+            witness_weight_[source] = ZERO_WEIGHT;
+            queue.emplace(ZERO_WEIGHT, source);
+            size_t settled = 0;
+            while (!queue.empty() && settled < max_settled && unresolved > 0) {
+                const auto [weight, vertex] = queue.top();
+                queue.pop();
+                if (weight > witness_weight_[vertex]) {
+                    continue;
+                }
+                if (max_weight < weight) {
+                    break;
+                }
+                ++settled;
+                for (const auto& edge : out_[vertex]) {
+                    if (edge.other == excluded || contracted_[edge.other]) {
+                        continue;
+                    }
+                    const Weight candidate = weight + edge.weight;
+                    if (witness_mark_[edge.other] != current_mark_ || candidate < witness_weight_[edge.other]) {
+                        const bool was_resolved = witness_mark_[edge.other] == current_mark_
+                                                  && !(target_limit_[edge.other] < witness_weight_[edge.other]);
+                        witness_mark_[edge.other] = current_mark_;
+                        witness_weight_[edge.other] = candidate;
+                        queue.emplace(candidate, edge.other);
+                        if (target_mark_[edge.other] == current_mark_ && !was_resolved
+                            && !(target_limit_[edge.other] < candidate)) {
+                            --unresolved;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+            : graph_(graph) {
+        Contractor(*this).Run();
+        BuildSearchGraphs();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, const tc_serialize::TransportCatalogue& tc_,
+                                                       const std::vector<EdgeId>& restored_edge_ids)
+            : graph_(graph) {
+        RestoreFrom(tc_, restored_edge_ids);
+    }
+
+    template <typename Weight>
+    size_t ContractionHierarchy<Weight>::GetShortcutCount() const {
+        return shortcuts_.size();
+    }
+
+    template <typename Weight>
+    VertexId ContractionHierarchy<Weight>::GetEdgeFrom(EdgeId edge) const {
+        return edge < graph_.GetEdgeCount() ? graph_.GetEdge(edge).from : shortcuts_[edge - graph_.GetEdgeCount()].from;
+    }
+
+    template <typename Weight>
+    VertexId ContractionHierarchy<Weight>::GetEdgeTo(EdgeId edge) const {
+        return edge < graph_.GetEdgeCount() ? graph_.GetEdge(edge).to : shortcuts_[edge - graph_.GetEdgeCount()].to;
+    }
+
+    template <typename Weight>
+    Weight ContractionHierarchy<Weight>::GetEdgeWeight(EdgeId edge) const {
+        return edge < graph_.GetEdgeCount() ? graph_.GetEdge(edge).weight : shortcuts_[edge - graph_.GetEdgeCount()].weight;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraphs() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<std::vector<Arc>> up_lists(vertex_count);
+        std::vector<std::vector<Arc>> down_lists(vertex_count);
+        const EdgeId edge_count = graph_.GetEdgeCount() + shortcuts_.size();
+        for (EdgeId edge = 0; edge < edge_count; ++edge) {
+            const VertexId from = GetEdgeFrom(edge);
+            const VertexId to = GetEdgeTo(edge);
+            if (from == to) {
+                continue;
+            }
+            if (ranks_[from] < ranks_[to]) {
+                up_lists[from].push_back({to, GetEdgeWeight(edge), edge});
+            } else {
+                down_lists[to].push_back({from, GetEdgeWeight(edge), edge});
+            }
+        }
+        FillSearchGraph(up_lists, up_offsets_, up_arcs_);
+        FillSearchGraph(down_lists, down_offsets_, down_arcs_);
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::FillSearchGraph(std::vector<std::vector<Arc>>& lists, std::vector<size_t>& offsets,
+                                                       std::vector<Arc>& arcs) {
+        offsets.assign(1, 0);
+        arcs.clear();
+        for (auto& list : lists) {
+            // из параллельных рёбер для поиска достаточно самого лёгкого
+            std::sort(list.begin(), list.end(), [](const Arc& lhs, const Arc& rhs) {
+                return std::tie(lhs.head, lhs.weight, lhs.edge) < std::tie(rhs.head, rhs.weight, rhs.edge);
+            });
+            for (size_t i = 0; i < list.size(); ++i) {
+                if (i == 0 || list[i].head != list[i - 1].head) {
+                    arcs.push_back(list[i]);
+                }
+            }
+            offsets.push_back(arcs.size());
+            std::vector<Arc>().swap(list);
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{edge};
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < graph_.GetEdgeCount()) {
+                edges.push_back(current);
+                continue;
+            }
+            const Shortcut& shortcut = shortcuts_[current - graph_.GetEdgeCount()];
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::Route>
+    ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        return BuildRoute(std::vector<RouteEndpoint<Weight>>{{from, ZERO_WEIGHT}},
+                          std::vector<RouteEndpoint<Weight>>{{to, ZERO_WEIGHT}});
+    }
+
+    // Все структуры поиска локальны для запроса, поэтому BuildRoute можно вызывать из нескольких потоков.
+    // Несколько точек from (to) - то же, что поиск от виртуальной вершины: все они сразу кладутся в очередь со своими весами
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::Route>
+    ContractionHierarchy<Weight>::BuildRoute(const std::vector<RouteEndpoint<Weight>>& from,
+                                             const std::vector<RouteEndpoint<Weight>>& to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+        std::vector<std::optional<Label>> forward(vertex_count);
+        std::vector<std::optional<Label>> backward(vertex_count);
+        Queue forward_queue;
+        Queue backward_queue;
+        auto seed = [vertex_count](const std::vector<RouteEndpoint<Weight>>& endpoints, std::vector<std::optional<Label>>& labels,
+                                   Queue& queue) {
+            for (const auto& [vertex, weight] : endpoints) {
+                if (vertex >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                if (!labels[vertex] || weight < labels[vertex]->weight) {
+                    labels[vertex] = Label{weight, std::nullopt};
+                    queue.emplace(weight, vertex);
+                }
+            }
+        };
+        seed(from, forward, forward_queue);
+        seed(to, backward, backward_queue);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = 0;
+        for (const auto& endpoint : from) {
+            const VertexId vertex = endpoint.vertex;
+            if (backward[vertex] && (!best_weight || forward[vertex]->weight + backward[vertex]->weight < *best_weight)) {
+                best_weight = forward[vertex]->weight + backward[vertex]->weight;
+                meeting_vertex = vertex;
+            }
+        }
+        auto is_active = [&best_weight](const Queue& queue) {
+            return !queue.empty() && (!best_weight || queue.top().first < *best_weight);
+        };
+        while (is_active(forward_queue) || is_active(backward_queue)) {
+            const bool forward_step = is_active(forward_queue)
+                                      && (!is_active(backward_queue) || forward_queue.top().first <= backward_queue.top().first);
+            Queue& queue = forward_step ? forward_queue : backward_queue;
+            auto& labels = forward_step ? forward : backward;
+            const auto& other_labels = forward_step ? backward : forward;
+            const auto& offsets = forward_step ? up_offsets_ : down_offsets_;
+            const auto& arcs = forward_step ? up_arcs_ : down_arcs_;
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (labels[vertex]->weight < weight) {
+                continue;
+            }
+            if (other_labels[vertex]) {
+                const Weight candidate = weight + other_labels[vertex]->weight;
+                if (!best_weight || candidate < *best_weight) {
+                    best_weight = candidate;
+                    meeting_vertex = vertex;
+                }
+            }
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = arcs[i];
+                const Weight candidate = weight + arc.weight;
+                if (!labels[arc.head] || candidate < labels[arc.head]->weight) {
+                    labels[arc.head] = Label{candidate, arc.edge};
+                    queue.emplace(candidate, arc.head);
+                }
+            }
+        }
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> ch_edges;
+        for (std::optional<EdgeId> edge = forward[meeting_vertex]->edge; edge; edge = forward[GetEdgeFrom(*edge)]->edge) {
+            ch_edges.push_back(*edge);
+        }
+        std::reverse(ch_edges.begin(), ch_edges.end());
+        for (std::optional<EdgeId> edge = backward[meeting_vertex]->edge; edge; edge = backward[GetEdgeTo(*edge)]->edge) {
+            ch_edges.push_back(*edge);
+        }
+        Route result{*best_weight, {}};
+        for (const EdgeId edge : ch_edges) {
+            UnpackEdge(edge, result.edges);
+        }
+        return result;
+    }
+
+    // Поиск "многие ко многим" с корзинами: обратный поиск вверх от каждой цели оставляет в пройденных вершинах
+    // записи (цель, вес), прямой поиск вверх от каждого источника складывает свой вес с записями корзин.
+    // Вершина с наибольшим рангом кратчайшего пути достигается обоими поисками, поэтому минимум по корзинам точен.
+    template <typename Weight>
+    std::vector<std::optional<Weight>>
+    ContractionHierarchy<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<std::optional<Weight>> labels(vertex_count);
+        std::vector<std::pair<VertexId, Weight>> settled;
+        std::vector<std::vector<std::pair<size_t, Weight>>> buckets(vertex_count);
+        for (size_t target = 0; target < to.size(); ++target) {
+            SearchUpward(to[target], false, labels, settled);
+            for (const auto& [vertex, weight] : settled) {
+                buckets[vertex].emplace_back(target, weight);
+            }
+        }
+        std::vector<std::optional<Weight>> result(from.size() * to.size());
+        for (size_t source = 0; source < from.size(); ++source) {
+            SearchUpward(from[source], true, labels, settled);
+            std::optional<Weight>* row = result.data() + source * to.size();
+            for (const auto& [vertex, weight] : settled) {
+                for (const auto& [target, target_weight] : buckets[vertex]) {
+                    const Weight candidate = weight + target_weight;
+                    if (!row[target] || candidate < *row[target]) {
+                        row[target] = candidate;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Полный поиск Дейкстры вверх по иерархии; labels после поиска снова пусты, settled - вершины с окончательными весами
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchUpward(VertexId start, bool forward, std::vector<std::optional<Weight>>& labels,
+                                                    std::vector<std::pair<VertexId, Weight>>& settled) const {
+        if (start >= labels.size()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        const auto& offsets = forward ? up_offsets_ : down_offsets_;
+        const auto& arcs = forward ? up_arcs_ : down_arcs_;
+        std::vector<VertexId> touched{start};
+        settled.clear();
+        labels[start] = ZERO_WEIGHT;
+        queue.emplace(ZERO_WEIGHT, start);
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*labels[vertex] < weight) {
+                continue;
+            }
+            settled.emplace_back(vertex, weight);
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = arcs[i];
+                const Weight candidate = weight + arc.weight;
+                if (!labels[arc.head]) {
+                    touched.push_back(arc.head);
+                } else if (!(candidate < *labels[arc.head])) {
+                    continue;
+                }
+                labels[arc.head] = candidate;
+                queue.emplace(candidate, arc.head);
+            }
+        }
+        for (const VertexId vertex : touched) {
+            labels[vertex].reset();
+        }
+    }
+
+    template <typename Weight>
+    bool ContractionHierarchy<Weight>::SaveTo(tc_serialize::TransportCatalogue& tc_to) const {
+        tc_serialize::ContractionHierarchyPB out;
+        for (const uint32_t rank : ranks_) {
+            out.add_ranks(rank);
+        }
+        for (const Shortcut& shortcut : shortcuts_) {
+            tc_serialize::ShortcutPB* shortcut_out = out.add_shortcuts();
+            shortcut_out->set_from(shortcut.from);
+            shortcut_out->set_to(shortcut.to);
+            shortcut_out->set_weight(shortcut.weight);
+            shortcut_out->set_first(shortcut.first);
+            shortcut_out->set_second(shortcut.second);
+        }
+        *(tc_to.mutable_router_settings()->mutable_contraction_hierarchy()) = std::move(out);
+        return true;
+    }
+
+    template <typename Weight>
+    bool ContractionHierarchy<Weight>::RestoreFrom(const tc_serialize::TransportCatalogue& tc_from,
+                                                   const std::vector<EdgeId>& restored_edge_ids) {
+        // повреждённые данные дали бы выход за границы при поиске, поэтому проверяются до построения поисковых графов
+        const auto& data_from = tc_from.router_settings().contraction_hierarchy();
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (static_cast<size_t>(data_from.ranks_size()) != vertex_count) {
+            throw std::logic_error("Corrupted contraction hierarchy: wrong number of ranks");
+        }
+        std::vector<bool> rank_used(vertex_count, false);
+        for (const uint32_t rank : data_from.ranks()) {
+            if (rank >= vertex_count || rank_used[rank]) {
+                throw std::logic_error("Corrupted contraction hierarchy: ranks are not a permutation");
+            }
+            rank_used[rank] = true;
+        }
+        ranks_.assign(data_from.ranks().begin(), data_from.ranks().end());
+        shortcuts_.clear();
+        shortcuts_.reserve(data_from.shortcuts_size());
+        const size_t edge_count = graph_.GetEdgeCount();
+        // номера от числа рёбер графа и дальше - сокращения, при перенумерации рёбер они не меняются
+        auto restore_edge_id = [&restored_edge_ids](uint64_t edge) {
+            return edge < restored_edge_ids.size() ? restored_edge_ids[edge] : static_cast<EdgeId>(edge);
+        };
+        for (int i = 0; i < data_from.shortcuts_size(); ++i) {
+            const tc_serialize::ShortcutPB& shortcut = data_from.shortcuts(i);
+            const Shortcut restored{static_cast<VertexId>(shortcut.from()), static_cast<VertexId>(shortcut.to()), shortcut.weight(),
+                                    restore_edge_id(shortcut.first()), restore_edge_id(shortcut.second())};
+            // сокращение состоит из рёбер графа и сокращений, добавленных раньше него
+            const size_t known_edges = edge_count + shortcuts_.size();
+            if (shortcut.from() >= vertex_count || shortcut.to() >= vertex_count
+                || shortcut.first() >= known_edges || shortcut.second() >= known_edges
+                || GetEdgeFrom(restored.first) != restored.from || GetEdgeTo(restored.first) != GetEdgeFrom(restored.second)
+                || GetEdgeTo(restored.second) != restored.to) {
+                throw std::logic_error("Corrupted contraction hierarchy: invalid shortcut");
+            }
+            shortcuts_.push_back(restored);
+        }
+        BuildSearchGraphs();
+        return true;
+    }
+}  // namespace graph
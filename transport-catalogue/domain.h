@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 #include <iomanip>
@@ -7,9 +8,13 @@
 
 namespace transport {
 
+    // Номер остановки в справочнике, начиная с 1; 0 - остановка не найдена
+    using StopId = uint32_t;
+
     struct Stop {
-        uint32_t id = 0;
-        std::string stop_name;
+        StopId id = 0;
+        // в справочнике имена указывают в его хранилище строк, во входных данных - в разбираемый запрос
+        std::string_view stop_name;
         geo::Coordinates coordinates;
     };
 
@@ -29,14 +34,13 @@ namespace transport {
     };
 
     struct BusRoute {
-        std::string bus_name;
+        std::string_view bus_name;
         RouteType type;
         std::vector<const Stop *> route_stops;
     };
 
     const Stop EMPTY_STOP{};
     const BusRoute EMPTY_BUS_ROUTE{};
-    const std::set<std::string_view> EMPTY_BUS_ROUTE_SET{};
 
     struct BusInfo {
         std::string_view bus_name;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace flat_hash {
+
+/*
+ * Хеш-таблица с открытой адресацией и линейным пробированием: ключи и значения лежат в непрерывных массивах,
+ * без выделения памяти на каждый элемент. Удаление не поддерживается - справочник только добавляет данные.
+ */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class FlatHashMap {
+    public:
+        // Возвращает false, если ключ уже есть, значение при этом не меняется
+        bool Insert(const Key& key, Value value) {
+            Reserve(size_ + 1);
+            const size_t slot = FindSlot(key);
+            if (used_[slot]) {
+                return false;
+            }
+            Place(slot, key, std::move(value));
+            return true;
+        }
+
+        void InsertOrAssign(const Key& key, Value value) {
+            Reserve(size_ + 1);
+            const size_t slot = FindSlot(key);
+            if (used_[slot]) {
+                values_[slot] = std::move(value);
+            } else {
+                Place(slot, key, std::move(value));
+            }
+        }
+
+        const Value* Find(const Key& key) const {
+            if (size_ == 0) {
+                return nullptr;
+            }
+            const size_t slot = FindSlot(key);
+            return used_[slot] ? &values_[slot] : nullptr;
+        }
+
+        size_t Size() const {
+            return size_;
+        }
+
+        template <typename Func>
+        void ForEach(Func func) const {
+            for (size_t slot = 0; slot < used_.size(); ++slot) {
+                if (used_[slot]) {
+                    func(keys_[slot], values_[slot]);
+                }
+            }
+        }
+
+        // Заполнение не превышает половины ёмкости, чтобы цепочки пробирования оставались короткими
+        void Reserve(size_t count) {
+            if (count * 2 <= used_.size()) {
+                return;
+            }
+            size_t capacity = used_.empty() ? 16 : used_.size();
+            while (capacity < count * 2) {
+                capacity *= 2;
+            }
+            std::vector<Key> keys(capacity);
+            std::vector<Value> values(capacity);
+            std::vector<uint8_t> used(capacity, 0);
+            keys_.swap(keys);
+            values_.swap(values);
+            used_.swap(used);
+            size_ = 0;
+            for (size_t slot = 0; slot < used.size(); ++slot) {
+                if (used[slot]) {
+                    Place(FindSlot(keys[slot]), keys[slot], std::move(values[slot]));
+                }
+            }
+        }
+
+    private:
+        size_t FindSlot(const Key& key) const {
+            const size_t mask = used_.size() - 1;
+            size_t slot = hasher_(key) & mask;
+            while (used_[slot] && !(keys_[slot] == key)) {
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+
+        void Place(size_t slot, const Key& key, Value value) {
+            keys_[slot] = key;
+            values_[slot] = std::move(value);
+            used_[slot] = 1;
+            ++size_;
+        }
+
+        std::vector<Key> keys_;
+        std::vector<Value> values_;
+        std::vector<uint8_t> used_;
+        size_t size_ = 0;
+        Hash hasher_;
+    };
+
+}  // namespace flat_hash
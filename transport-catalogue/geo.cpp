@@ -1,15 +1,149 @@
 #include "geo.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GEO_HAS_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
  namespace geo {
+    namespace {
+        const double RADIANS_PER_DEGREE = 3.1415926535 / 180.;
+        const int EARTH_RADIUS = 6371000;
+
+        // Точки ломаной как единичные векторы в трёхмерном пространстве: синусы и косинусы считаются один раз на точку
+        struct UnitVectors {
+            explicit UnitVectors(const double* latitudes, const double* longitudes, size_t count)
+                    : x(count), y(count), z(count) {
+                for (size_t i = 0; i < count; ++i) {
+                    const double cos_lat = std::cos(latitudes[i] * RADIANS_PER_DEGREE);
+                    x[i] = cos_lat * std::cos(longitudes[i] * RADIANS_PER_DEGREE);
+                    y[i] = cos_lat * std::sin(longitudes[i] * RADIANS_PER_DEGREE);
+                    z[i] = std::sin(latitudes[i] * RADIANS_PER_DEGREE);
+                }
+            }
+
+            std::vector<double> x;
+            std::vector<double> y;
+            std::vector<double> z;
+        };
+
+        // Половина длины хорды между соседними точками отрезков [begin, end), равна синусу половины центрального угла.
+        // Порядок операций совпадает с векторной версией, чтобы результат не зависел от процессора
+        void ComputeHalfChords(const UnitVectors& points, size_t begin, size_t end, double* half_chords) {
+            for (size_t i = begin; i < end; ++i) {
+                const double dx = points.x[i + 1] - points.x[i];
+                const double dy = points.y[i + 1] - points.y[i];
+                const double dz = points.z[i + 1] - points.z[i];
+                half_chords[i] = std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5;
+            }
+        }
+
+#ifdef GEO_HAS_AVX2_KERNEL
+        // Возвращает число обработанных отрезков, кратное четырём
+        __attribute__((target("avx2")))
+        size_t ComputeHalfChordsAvx2(const UnitVectors& points, size_t segment_count, double* half_chords) {
+            const __m256d half = _mm256_set1_pd(0.5);
+            size_t i = 0;
+            for (; i + 4 <= segment_count; i += 4) {
+                const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&points.x[i + 1]), _mm256_loadu_pd(&points.x[i]));
+                const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&points.y[i + 1]), _mm256_loadu_pd(&points.y[i]));
+                const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&points.z[i + 1]), _mm256_loadu_pd(&points.z[i]));
+                const __m256d squared = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+                                                      _mm256_mul_pd(dz, dz));
+                _mm256_storeu_pd(half_chords + i, _mm256_mul_pd(_mm256_sqrt_pd(squared), half));
+            }
+            return i;
+        }
+
+        bool HasAvx2() {
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2;
+        }
+#endif
+
+        // Центральный угол по синусу его половины. Для отрезков короче ~600 км asin заменяется рядом Тейлора,
+        // его погрешность меньше погрешности округления double
+        double CentralAngle(double half_chord) {
+            if (half_chord >= 0.05) {
+                return 2 * std::asin(std::min(1.0, half_chord));
+            }
+            const double x2 = half_chord * half_chord;
+            const double series = 1 + x2 * (1.0 / 6 + x2 * (3.0 / 40 + x2 * (5.0 / 112 + x2 * (35.0 / 1152 + x2 * (63.0 / 2816)))));
+            return 2 * half_chord * series;
+        }
+    }
 
     double ComputeDistance(Coordinates from, Coordinates to) {
          using namespace std;
          if (from == to) {
              return 0;
          }
-         static const double RADIANS_PER_DEGREE = 3.1415926535 / 180.;
-         static const int EARTH_RADIUS = 6371000;
          return acos(sin(from.latitude * RADIANS_PER_DEGREE) * sin(to.latitude * RADIANS_PER_DEGREE)
                      + cos(from.latitude * RADIANS_PER_DEGREE) * cos(to.latitude * RADIANS_PER_DEGREE) * cos(abs(from.longitude - to.longitude) * RADIANS_PER_DEGREE))
                 * EARTH_RADIUS;
      }
-}//namespace geo
\ No newline at end of file
+
+    namespace {
+        double HaversineDistance(Coordinates from, Coordinates to, double cos_from_lat, double cos_to_lat) {
+            using namespace std;
+            if (from == to) {
+                return 0;
+            }
+            const double sin_half_dlat = sin((to.latitude - from.latitude) * RADIANS_PER_DEGREE / 2);
+            const double sin_half_dlon = sin((to.longitude - from.longitude) * RADIANS_PER_DEGREE / 2);
+            const double h = sin_half_dlat * sin_half_dlat + cos_from_lat * cos_to_lat * sin_half_dlon * sin_half_dlon;
+            return 2 * asin(min(1.0, sqrt(h))) * EARTH_RADIUS;
+        }
+    }
+
+    double ComputeDistanceHaversine(Coordinates from, Coordinates to) {
+        return HaversineDistance(from, to, std::cos(from.latitude * RADIANS_PER_DEGREE), std::cos(to.latitude * RADIANS_PER_DEGREE));
+    }
+
+    double ComputeDistanceToParallel(Coordinates from, double latitude) {
+        return std::abs(latitude - from.latitude) * RADIANS_PER_DEGREE * EARTH_RADIUS;
+    }
+
+    double ComputeDistanceToMeridian(Coordinates from, double longitude) {
+        double delta_lon = std::fmod(std::abs(longitude - from.longitude), 360.);
+        delta_lon = std::min(delta_lon, 360. - delta_lon);
+        if (delta_lon >= 90.) {
+            // ближайшая точка меридиана - ближайший к точке полюс
+            return (90. - std::abs(from.latitude)) * RADIANS_PER_DEGREE * EARTH_RADIUS;
+        }
+        const double sin_angle = std::cos(from.latitude * RADIANS_PER_DEGREE) * std::sin(delta_lon * RADIANS_PER_DEGREE);
+        return std::asin(std::min(1.0, sin_angle)) * EARTH_RADIUS;
+    }
+
+    void ComputeSegmentDistances(const double* latitudes, const double* longitudes, size_t count, double* distances) {
+        if (count < 2) {
+            return;
+        }
+        const size_t segment_count = count - 1;
+        const UnitVectors points(latitudes, longitudes, count);
+        size_t done = 0;
+#ifdef GEO_HAS_AVX2_KERNEL
+        if (HasAvx2()) {
+            done = ComputeHalfChordsAvx2(points, segment_count, distances);
+        }
+#endif
+        ComputeHalfChords(points, done, segment_count, distances);
+        for (size_t i = 0; i < segment_count; ++i) {
+            distances[i] = CentralAngle(distances[i]) * EARTH_RADIUS;
+        }
+    }
+
+    void ComputeSegmentDistancesHaversine(const double* latitudes, const double* longitudes, size_t count, double* distances) {
+        std::vector<double> cos_lat(count);
+        for (size_t i = 0; i < count; ++i) {
+            cos_lat[i] = std::cos(latitudes[i] * RADIANS_PER_DEGREE);
+        }
+        for (size_t i = 0; i + 1 < count; ++i) {
+            distances[i] = HaversineDistance({latitudes[i], longitudes[i]}, {latitudes[i + 1], longitudes[i + 1]},
+                                             cos_lat[i], cos_lat[i + 1]);
+        }
+    }
+}//namespace geo
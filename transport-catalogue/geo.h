@@ -1,20 +1,37 @@
-#pragma once
-
-#include <cmath>
-
-namespace geo {
-
-    struct Coordinates {
-        double latitude;
-        double longitude;
-        bool operator==(const Coordinates& other) const {
-            return latitude == other.latitude && longitude == other.longitude;
-        }
-        bool operator!=(const Coordinates& other) const {
-            return !(latitude == other.latitude && longitude == other.longitude);
-        }
-    };
-
-    double ComputeDistance(Coordinates from, Coordinates to);
-
-}// namespace geo
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+namespace geo {
+
+    struct Coordinates {
+        double latitude;
+        double longitude;
+        bool operator==(const Coordinates& other) const {
+            return latitude == other.latitude && longitude == other.longitude;
+        }
+        bool operator!=(const Coordinates& other) const {
+            return !(latitude == other.latitude && longitude == other.longitude);
+        }
+    };
+
+    double ComputeDistance(Coordinates from, Coordinates to);
+    // Формула гаверсинусов: устойчива для близких точек, совпадает с ComputeDistance в пределах погрешности
+    double ComputeDistanceHaversine(Coordinates from, Coordinates to);
+    // Кратчайшее расстояние от точки до параллели с широтой latitude
+    double ComputeDistanceToParallel(Coordinates from, double latitude);
+    // Кратчайшее расстояние от точки до меридиана с долготой longitude (полуокружности от полюса до полюса)
+    double ComputeDistanceToMeridian(Coordinates from, double longitude);
+
+/*
+ * Пакетный расчёт расстояний вдоль ломаной по координатам в виде структуры массивов:
+ * distances[i] - расстояние от точки i до точки i + 1, всего count - 1 значений.
+ * Синусы и косинусы координат считаются один раз на точку, а не на каждый отрезок, расстояние получается
+ * из длины хорды между точками (без acos на отрезок); хорды считаются по четыре с AVX2, если процессор его поддерживает.
+ * Совпадает с ComputeDistance в пределах погрешности округления.
+ */
+    void ComputeSegmentDistances(const double* latitudes, const double* longitudes, size_t count, double* distances);
+    void ComputeSegmentDistancesHaversine(const double* latitudes, const double* longitudes, size_t count, double* distances);
+
+}// namespace geo
@@ -2,13 +2,16 @@
 
 #include "ranges.h"
 
+#include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
 
-    using VertexId = size_t;
-    using EdgeId = size_t;
+    using VertexId = uint32_t;
+    using EdgeId = uint32_t;
 
     template <typename Weight>
     struct Edge {
@@ -18,16 +21,40 @@ namespace graph {
         Weight weight;
     };
 
+    // Начало или конец маршрута, заданные не вершиной графа: виртуальная вершина, связанная с vertex ребром веса weight.
+    // Маршрутизатор принимает несколько таких точек сразу и сам граф при этом не меняется
+    template <typename Weight>
+    struct RouteEndpoint {
+        VertexId vertex;
+        Weight weight;
+    };
+
+/*
+ * Граф строится в два этапа: рёбра добавляются через AddEdge, затем Freeze() укладывает их
+ * в формат CSR - рёбра упорядочены по исходящей вершине, а offsets_[v]..offsets_[v + 1] -
+ * идентификаторы рёбер, выходящих из v. Обход соседей после этого идёт по непрерывному участку памяти.
+ * Freeze() меняет идентификаторы рёбер и возвращает соответствие старый -> новый.
+ * AttachFrozen() подключает уже упакованные рёбра и смещения из внешнего буфера (например, отображённого
+ * в память файла) без копирования, буфер должен жить дольше графа.
+ * Копия замороженного графа читает свои edges_ и offsets_, копия подключённого - тот же внешний буфер.
+ */
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
-        using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidentEdgesRange = ranges::Range<ranges::CountingIterator<EdgeId>>;
 
     public:
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
+        DirectedWeightedGraph(const DirectedWeightedGraph& other);
+        DirectedWeightedGraph(DirectedWeightedGraph&& other) noexcept;
+        DirectedWeightedGraph& operator=(const DirectedWeightedGraph& other);
+        DirectedWeightedGraph& operator=(DirectedWeightedGraph&& other) noexcept;
+        ~DirectedWeightedGraph() = default;
         EdgeId AddEdge(const Edge<Weight>& edge);
+        std::vector<EdgeId> Freeze();
+        void AttachFrozen(size_t vertex_count, const Edge<Weight>* edges, size_t edge_count, const EdgeId* offsets);
+        bool IsFrozen() const;
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
@@ -35,41 +62,177 @@ namespace graph {
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
     protected:
-        std::vector<IncidenceList> incidence_lists_;
+        size_t vertex_count_ = 0;
         std::vector<Edge<Weight>> edges_;
+        std::vector<EdgeId> offsets_;
+        // замороженный граф читается через эти указатели: на edges_ и offsets_ или во внешний буфер
+        const Edge<Weight>* frozen_edges_ = nullptr;
+        const EdgeId* frozen_offsets_ = nullptr;
+        size_t frozen_edge_count_ = 0;
+        // рёбра подключены через AttachFrozen и лежат вне графа
+        bool attached_ = false;
+
+    private:
+        // после копирования или перемещения указатели замороженного графа переводятся на собственные векторы
+        void RebindFrozen();
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-            : incidence_lists_(vertex_count) {
+            : vertex_count_(vertex_count) {
+    }
+
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(const DirectedWeightedGraph& other)
+            : vertex_count_(other.vertex_count_)
+            , edges_(other.edges_)
+            , offsets_(other.offsets_)
+            , frozen_edges_(other.frozen_edges_)
+            , frozen_offsets_(other.frozen_offsets_)
+            , frozen_edge_count_(other.frozen_edge_count_)
+            , attached_(other.attached_) {
+        RebindFrozen();
+    }
+
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(DirectedWeightedGraph&& other) noexcept
+            : vertex_count_(other.vertex_count_)
+            , edges_(std::move(other.edges_))
+            , offsets_(std::move(other.offsets_))
+            , frozen_edges_(std::exchange(other.frozen_edges_, nullptr))
+            , frozen_offsets_(std::exchange(other.frozen_offsets_, nullptr))
+            , frozen_edge_count_(std::exchange(other.frozen_edge_count_, 0))
+            , attached_(std::exchange(other.attached_, false)) {
+        RebindFrozen();
+    }
+
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>& DirectedWeightedGraph<Weight>::operator=(const DirectedWeightedGraph& other) {
+        if (this != &other) {
+            DirectedWeightedGraph copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>& DirectedWeightedGraph<Weight>::operator=(DirectedWeightedGraph&& other) noexcept {
+        if (this != &other) {
+            vertex_count_ = other.vertex_count_;
+            edges_ = std::move(other.edges_);
+            offsets_ = std::move(other.offsets_);
+            frozen_edges_ = std::exchange(other.frozen_edges_, nullptr);
+            frozen_offsets_ = std::exchange(other.frozen_offsets_, nullptr);
+            frozen_edge_count_ = std::exchange(other.frozen_edge_count_, 0);
+            attached_ = std::exchange(other.attached_, false);
+            RebindFrozen();
+        }
+        return *this;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::RebindFrozen() {
+        if (frozen_offsets_ != nullptr && !attached_) {
+            frozen_edges_ = edges_.data();
+            frozen_offsets_ = offsets_.data();
+        }
     }
 
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (IsFrozen()) {
+            throw std::logic_error("Can't add an edge to a frozen graph");
+        }
+        if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+            throw std::out_of_range("Edge vertex is out of range");
+        }
         edges_.push_back(edge);
-        const EdgeId id = edges_.size() - 1;
-        incidence_lists_.at(edge.from).push_back(id);
-        return id;
+        return edges_.size() - 1;
+    }
+
+    template <typename Weight>
+    std::vector<EdgeId> DirectedWeightedGraph<Weight>::Freeze() {
+        std::vector<EdgeId> new_ids(GetEdgeCount());
+        if (IsFrozen()) {
+            for (EdgeId edge_id = 0; edge_id < new_ids.size(); ++edge_id) {
+                new_ids[edge_id] = edge_id;
+            }
+            return new_ids;
+        }
+        // сортировка подсчётом по исходящей вершине, порядок рёбер одной вершины сохраняется
+        offsets_.assign(vertex_count_ + 1, 0);
+        for (const auto& edge : edges_) {
+            ++offsets_[edge.from + 1];
+        }
+        for (size_t vertex = 0; vertex < vertex_count_; ++vertex) {
+            offsets_[vertex + 1] += offsets_[vertex];
+        }
+        std::vector<EdgeId> next_position(offsets_.begin(), offsets_.end() - 1);
+        std::vector<EdgeId> old_ids(edges_.size());
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            new_ids[edge_id] = next_position[edges_[edge_id].from]++;
+            old_ids[new_ids[edge_id]] = edge_id;
+        }
+        std::vector<Edge<Weight>> sorted_edges;
+        sorted_edges.reserve(edges_.size());
+        for (const EdgeId old_id : old_ids) {
+            sorted_edges.push_back(edges_[old_id]);
+        }
+        edges_ = std::move(sorted_edges);
+        frozen_edges_ = edges_.data();
+        frozen_offsets_ = offsets_.data();
+        frozen_edge_count_ = edges_.size();
+        return new_ids;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::AttachFrozen(size_t vertex_count, const Edge<Weight>* edges, size_t edge_count,
+                                                     const EdgeId* offsets) {
+        if (IsFrozen() || !edges_.empty()) {
+            throw std::logic_error("Can't attach edges to a non-empty graph");
+        }
+        vertex_count_ = vertex_count;
+        frozen_edges_ = edges;
+        frozen_offsets_ = offsets;
+        frozen_edge_count_ = edge_count;
+        attached_ = true;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return frozen_offsets_ != nullptr;
     }
 
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
 
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
-        return edges_.size();
+        return IsFrozen() ? frozen_edge_count_ : edges_.size();
     }
 
     template <typename Weight>
     const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-        return edges_.at(edge_id);
+        if (!IsFrozen()) {
+            return edges_.at(edge_id);
+        }
+        if (edge_id >= frozen_edge_count_) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        return frozen_edges_[edge_id];
     }
 
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return ranges::AsRange(incidence_lists_.at(vertex));
+        if (!IsFrozen()) {
+            throw std::logic_error("Graph should be frozen before traversal");
+        }
+        if (vertex >= vertex_count_) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        return ranges::AsCountingRange(frozen_offsets_[vertex], frozen_offsets_[vertex + 1]);
     }
 }  // namespace graph
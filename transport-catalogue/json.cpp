@@ -1,6 +1,9 @@
 #include "json.h"
 #include <exception>
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
 
 using namespace std;
 using namespace std::literals;
@@ -93,179 +96,297 @@ namespace json {
         }
     }
 
-    Node LoadNode(istream& input);
-    Node LoadArray(istream& input) {
-        Array result;
-        bool first = true;
-        char c;
-        for (; input >> c && c != ']';) {
-            if(first) {
-                if (c == ',') {
-                    throw ParsingError("Array separator invalid: "s + c);
+    namespace {
+/*
+ * Разбор JSON по непрерывному буферу: символы читаются по индексу, строки копируются участками
+ * между экранированиями, числа преобразуются std::from_chars без промежуточной строки.
+ * Один и тот же разбор строит дерево Node (LoadNode) или сообщает события обработчику (ParseNode).
+ * Для потока буфер дочитывается кусками по CHUNK_SIZE, разобранная часть при этом отбрасывается.
+ */
+        class BufferParser {
+        public:
+            explicit BufferParser(std::string_view text)
+                    : text_(text) {
+            }
+
+            explicit BufferParser(std::istream& input)
+                    : input_(&input) {
+            }
+
+            Node LoadNode() {
+                const char c = NextToken();
+                if (c == '[') {
+                    Array result;
+                    ReadArray([this, &result]() { result.push_back(LoadNode()); });
+                    return Node(std::move(result));
                 }
-                first = false;
-                input.putback(c);
-            } else if (c != ',') {
-                throw ParsingError("Array separator invalid: "s + c);
-            } result.push_back(LoadNode(input));
-        }
-        if(c != ']') {
-            throw ParsingError("Array ] not found"s);
-        } return Node(move(result));
-    }
+                if (c == '{') {
+                    Dict result;
+                    ReadDict([this, &result](std::string key) { result.insert({std::move(key), LoadNode()}); });
+                    return Node(std::move(result));
+                }
+                return LoadScalar(c);
+            }
 
-    Node LoadString(istream& input) {
-        string line;
-        char c;
-        for(c = input.get(); input && c != '\"'; c = input.get()) {
-            if(c == '\\') {
-                c = input.get();
-                switch(c) {
-                    case 'n': line.push_back('\n'); break;
-                    case 'r': line.push_back('\r'); break;
-                    case 't': line.push_back('\t'); break;
-                    default: line.push_back(c);
+            void ParseNode(Handler& handler) {
+                const char c = NextToken();
+                if (c == '[') {
+                    handler.StartArray();
+                    ReadArray([this, &handler]() { ParseNode(handler); });
+                    handler.EndArray();
+                } else if (c == '{') {
+                    handler.StartDict();
+                    ReadDict([this, &handler](std::string key) {
+                        handler.Key(std::move(key));
+                        ParseNode(handler);
+                    });
+                    handler.EndDict();
+                } else {
+                    handler.Value(LoadScalar(c));
                 }
-            } else {
-                line.push_back(c);
             }
-        }
-        if(c != '\"') {
-            throw ParsingError("String is not closed"s);
-        }
-        return Node(std::move(line));
-    }
 
-    Node LoadDict(istream& input) {
-        Dict result;
-        bool first = true;
-        char c;
-        for (; input >> c && c != '}';) {
-            if(first) {
-                if (c == ',') {
-                    throw ParsingError("Dict error format for first key \" != "s + c);
+        private:
+            static bool IsSpace(char c) {
+                const auto uc = static_cast<unsigned char>(c);
+                return isspace(uc) || iscntrl(uc);
+            }
+
+            // дочитывает следующий кусок потока, false - поток закончился или разбирается готовый текст.
+            // Отбрасывается всё до pos_, кроме начала читаемого числа (mark_)
+            bool Fill() {
+                if (input_ == nullptr) {
+                    return false;
+                }
+                const size_t consumed = std::min(pos_, mark_);
+                buffer_.erase(0, consumed);
+                pos_ -= consumed;
+                if (mark_ != NO_MARK) {
+                    mark_ -= consumed;
                 }
-                first = false;
-            } else if (c != ',') {
-                throw ParsingError("Dict error format , != "s + c);
-            } else {
-                input >> c;
+                const size_t size = buffer_.size();
+                buffer_.resize(size + CHUNK_SIZE);
+                input_->read(buffer_.data() + size, CHUNK_SIZE);
+                const auto count = static_cast<size_t>(input_->gcount());
+                buffer_.resize(size + count);
+                text_ = buffer_;
+                return count > 0;
             }
-            if(c != '\"') {
-                throw ParsingError("Dict error format \" != "s + c);
+
+            // пропускает пробельные символы и возвращает следующий символ, 0 в конце входных данных
+            char NextToken() {
+                while (true) {
+                    while (pos_ < text_.size() && IsSpace(text_[pos_])) {
+                        ++pos_;
+                    }
+                    if (pos_ < text_.size()) {
+                        return text_[pos_++];
+                    }
+                    if (!Fill()) {
+                        return '\0';
+                    }
+                }
             }
-            string key = LoadString(input).AsString();
-            if(!(input >> c)) {
-                throw ParsingError("Dict } not found"s);
+
+            char Peek() {
+                if (pos_ >= text_.size() && !Fill()) {
+                    return '\0';
+                }
+                return text_[pos_];
             }
-            if(c != ':') {
-                throw ParsingError("Dict error format : != "s + c);
+
+            template <typename ReadItem>
+            void ReadArray(ReadItem read_item) {
+                bool first = true;
+                char c;
+                for (c = NextToken(); c != '\0' && c != ']'; c = NextToken()) {
+                    if (first) {
+                        if (c == ',') {
+                            throw ParsingError("Array separator invalid: "s + c);
+                        }
+                        first = false;
+                        --pos_;
+                    } else if (c != ',') {
+                        throw ParsingError("Array separator invalid: "s + c);
+                    }
+                    read_item();
+                }
+                if (c != ']') {
+                    throw ParsingError("Array ] not found"s);
+                }
             }
-            result.insert({std::move(key), LoadNode(input)});
-        }
-        if(c != '}') {
-            throw ParsingError("Dict } not found"s);
-        }
-        return Node(std::move(result));
-    }
 
-    Node LoadNumber(istream& input) {
-        std::string digit;
-        char temp;
-        temp = input.peek();
-        if(temp != '-' && !isdigit(temp)) {
-            throw ParsingError("Digit begin invalid: "s + temp);
-        }
-        digit.push_back(input.get());
-        if(temp == '-') {
-            temp = input.peek();
-            if(!isdigit(temp)) {
-                throw ParsingError("First char is not digit: "s + temp);
+            template <typename ReadItem>
+            void ReadDict(ReadItem read_item) {
+                bool first = true;
+                char c;
+                for (c = NextToken(); c != '\0' && c != '}'; c = NextToken()) {
+                    if (first) {
+                        if (c == ',') {
+                            throw ParsingError("Dict error format for first key \" != "s + c);
+                        }
+                        first = false;
+                    } else if (c != ',') {
+                        throw ParsingError("Dict error format , != "s + c);
+                    } else {
+                        c = NextToken();
+                    }
+                    if (c != '"') {
+                        throw ParsingError("Dict error format \" != "s + c);
+                    }
+                    std::string key = ReadString();
+                    c = NextToken();
+                    if (c == '\0') {
+                        throw ParsingError("Dict } not found"s);
+                    }
+                    if (c != ':') {
+                        throw ParsingError("Dict error format : != "s + c);
+                    }
+                    read_item(std::move(key));
+                }
+                if (c != '}') {
+                    throw ParsingError("Dict } not found"s);
+                }
             }
-            digit.push_back(input.get());
-        }
-        while(isdigit(input.peek())) {
-            input >> temp;
-            digit.push_back(temp);
-        }
-        temp = input.peek();
-        if(temp != '.' && temp != 'e' && temp != 'E') {
-            return Node(stoi(digit));
-        }
-        if(temp == '.') {
-            digit.push_back(input.get());
 
-            temp = input.peek();
-            if(!isdigit(temp)) {
-                throw ParsingError("Not digit after dot: "s + temp);
+            Node LoadScalar(char c) {
+                if (c == '"') {
+                    return Node(ReadString());
+                }
+                if (c == 'n') {
+                    ReadLiteral("ull"sv, "null invalid"s);
+                    return Node(nullptr);
+                }
+                if (c == 't') {
+                    ReadLiteral("rue"sv, "Invalid bool"s);
+                    return Node(true);
+                }
+                if (c == 'f') {
+                    ReadLiteral("alse"sv, "Invalid bool"s);
+                    return Node(false);
+                }
+                if (c == '\0') {
+                    throw ParsingError("Unexpected end of input"s);
+                }
+                --pos_;
+                return ReadNumber();
             }
-            digit.push_back(input.get());
 
-            while(isdigit(input.peek())) {
-                input >> temp;
-                digit.push_back(temp);
+            void ReadLiteral(std::string_view rest, const std::string& error) {
+                while (text_.size() - pos_ < rest.size() && Fill()) {
+                }
+                if (text_.substr(pos_, rest.size()) != rest) {
+                    throw ParsingError(error);
+                }
+                pos_ += rest.size();
             }
-        }
-        temp = input.peek();
-        if(temp != 'e' && temp != 'E') {
-            return Node(stod(digit));
-        }
-        digit.push_back(input.get());
-        temp = input.peek();
-        if(temp != '+' && temp != '-' && !isdigit(temp)) {
-            throw ParsingError("Not +/- after e: "s + temp);
-        }
-        digit.push_back(input.get());
-        if(!isdigit(temp)) {
-            temp = input.peek();
-            if(!isdigit(temp)) {
-                throw ParsingError("Not digit after e+/-: "s + temp);
+
+            // экранированные \n, \r, \t заменяются управляющими символами, остальные - самим символом
+            std::string ReadString() {
+                std::string line;
+                while (true) {
+                    size_t stop = pos_;
+                    while (stop < text_.size() && text_[stop] != '"' && text_[stop] != '\\') {
+                        ++stop;
+                    }
+                    line.append(text_.data() + pos_, stop - pos_);
+                    pos_ = stop;
+                    if (pos_ >= text_.size()) {
+                        if (!Fill()) {
+                            throw ParsingError("String is not closed"s);
+                        }
+                        continue;
+                    }
+                    if (text_[pos_++] == '"') {
+                        return line;
+                    }
+                    if (pos_ >= text_.size() && !Fill()) {
+                        throw ParsingError("String is not closed"s);
+                    }
+                    switch (const char escaped = text_[pos_++]) {
+                        case 'n': line.push_back('\n'); break;
+                        case 'r': line.push_back('\r'); break;
+                        case 't': line.push_back('\t'); break;
+                        default: line.push_back(escaped);
+                    }
+                }
             }
-            digit.push_back(input.get());
-        }
-        while(isdigit(input.peek())) {
-            input >> temp;
-            digit.push_back(temp);
-        }
-        return Node(stod(digit));
-    }
 
-    Node LoadBool(istream& input) {
-        std::string line;
-        int c = input.get();
-        if(c == 't' && input.get() == 'r' && input.get() == 'u' && input.get() == 'e') {
-            return Node(true);
-        } else if(c == 'f' && input.get() == 'a' && input.get() == 'l' && input.get() == 's' && input.get() == 'e') {
-            return Node(false);
-        }
-        throw ParsingError("Invalid bool");
-    }
+            void ReadDigits() {
+                while (isdigit(static_cast<unsigned char>(Peek()))) {
+                    ++pos_;
+                }
+            }
 
-    Node LoadNull(istream& input) {
-        if(input.get() == 'u' && input.get() == 'l' && input.get() == 'l') {
-            return Node(nullptr);
-        } throw ParsingError("null invalid"s);
-    }
+            Node ReadNumber() {
+                mark_ = pos_;
+                char temp = Peek();
+                if (temp != '-' && !isdigit(static_cast<unsigned char>(temp))) {
+                    throw ParsingError("Digit begin invalid: "s + temp);
+                }
+                if (temp == '-') {
+                    ++pos_;
+                    temp = Peek();
+                    if (!isdigit(static_cast<unsigned char>(temp))) {
+                        throw ParsingError("First char is not digit: "s + temp);
+                    }
+                }
+                ReadDigits();
+                bool is_integer = true;
+                if (Peek() == '.') {
+                    ++pos_;
+                    temp = Peek();
+                    if (!isdigit(static_cast<unsigned char>(temp))) {
+                        throw ParsingError("Not digit after dot: "s + temp);
+                    }
+                    ReadDigits();
+                    is_integer = false;
+                }
+                if (Peek() == 'e' || Peek() == 'E') {
+                    ++pos_;
+                    temp = Peek();
+                    if (temp == '+' || temp == '-') {
+                        ++pos_;
+                        temp = Peek();
+                    }
+                    if (!isdigit(static_cast<unsigned char>(temp))) {
+                        throw ParsingError("Not digit after e+/-: "s + temp);
+                    }
+                    ReadDigits();
+                    is_integer = false;
+                }
+                const char* first = text_.data() + mark_;
+                const char* last = text_.data() + pos_;
+                mark_ = NO_MARK;
+                if (is_integer) {
+                    int value = 0;
+                    if (const auto [ptr, ec] = std::from_chars(first, last, value); ec == std::errc{} && ptr == last) {
+                        return Node(value);
+                    }
+                    // целое за пределами int читается как double
+                }
+                double value = 0.0;
+                const auto [ptr, ec] = std::from_chars(first, last, value);
+                if (ec != std::errc{} || ptr != last) {
+                    throw ParsingError("Invalid number: "s + std::string(first, last));
+                }
+                return Node(value);
+            }
 
-    Node LoadNode(istream& input) {
-        char c;
-        while(input >> c && (iscntrl(c) || isspace(c)));
-        if (c == '[') {
-            return LoadArray(input);
-        } else if (c == '{') {
-            return LoadDict(input);
-        } else if (c == '"') {
-            return LoadString(input);
-        } else if (c == 'n') {
-            return LoadNull(input);
-        } else if (c == 't' || c == 'f') {
-            input.putback(c);
-            return LoadBool(input);
-        } else {
-            input.putback(c);
-            return LoadNumber(input);
+            static constexpr size_t CHUNK_SIZE = 1 << 16;
+            static constexpr size_t NO_MARK = std::string_view::npos;
+
+            std::string_view text_;
+            size_t pos_ = 0;
+            std::istream* input_ = nullptr;
+            std::string buffer_;
+            size_t mark_ = NO_MARK;
+        };
+
+        std::string ReadAll(istream& input) {
+            return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
         }
-    }
+    }  // namespace
 
     Document::Document(Node root)
             : root_(std::move(root)) {
@@ -283,8 +404,24 @@ namespace json {
         return root_ != other.root_;
     }
 
+    Document Load(std::string_view text) {
+        return Document{BufferParser(text).LoadNode()};
+    }
+
     Document Load(istream& input) {
-        return Document{LoadNode(input)};
+        return Load(ReadAll(input));
+    }
+
+    void Parse(std::string_view text, Handler& handler) {
+        BufferParser(text).ParseNode(handler);
+    }
+
+    void Parse(istream& input, Handler& handler) {
+        BufferParser(input).ParseNode(handler);
+    }
+
+    void PrintValue(double value, svg::RenderContext context) {
+        context.out << svg::Number{value};
     }
 
     void PrintValue(std::nullptr_t, svg::RenderContext context) {
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <variant>
@@ -13,8 +14,6 @@ namespace json {
     class Node;
     using Dict = std::map<std::string, Node>;
     using Array = std::vector<Node>;
-    Node LoadNumber(std::istream& input);
-    Node LoadString(std::istream& is);
 
 // Эта ошибка должна выбрасываться при ошибках парсинга JSON
     class ParsingError : public std::runtime_error {
@@ -56,12 +55,36 @@ namespace json {
         Node root_;
     };
 
+    // Разбор идёт по непрерывному буферу, версии для потока читают его целиком
+    Document Load(std::string_view text);
     Document Load(std::istream& input);
+
+/*
+ * Обработчик событий потокового (SAX) разбора: Parse не строит дерево Node целиком,
+ * а сообщает о начале и конце словарей и массивов, ключах и скалярных значениях по мере чтения.
+ */
+    class Handler {
+    public:
+        virtual void StartDict() = 0;
+        virtual void EndDict() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void Key(std::string key) = 0;
+        virtual void Value(Node value) = 0;
+
+    protected:
+        ~Handler() = default;
+    };
+
+    void Parse(std::string_view text, Handler& handler);
+    // Поток читается кусками по мере разбора, а не целиком
+    void Parse(std::istream& input, Handler& handler);
     template <typename Value>
     void PrintValue(const Value& value, svg::RenderContext context) {
         std::ostream& out = context.out;
         out << value;
     }
+    void PrintValue(double value, svg::RenderContext context);
     void PrintValue(const std::string& str, svg::RenderContext context);
     void PrintValue(std::nullptr_t, svg::RenderContext context);
     void PrintValue(bool value, svg::RenderContext context);
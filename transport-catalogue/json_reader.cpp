@@ -1,6 +1,11 @@
 #include "json_reader.h"
 #include "json_builder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
 using namespace std::literals;
 using namespace transport;
 
@@ -20,34 +25,164 @@ namespace json_reader {
         return result;
     }
 
+    /*
+     * Потоковый разбор входного словаря make_base: элементы base_requests по одному собираются в Node
+     * и сразу передаются в справочник, так что дерево всего массива в памяти не строится.
+     * Остальные ключи верхнего уровня (настройки) собираются целиком и образуют корневой документ.
+     */
+    class JsonReader::StreamingHandler final : public json::Handler {
+    public:
+        explicit StreamingHandler(JsonReader &reader) : reader_(reader) {}
+
+        void StartDict() override {
+            if (depth_++ == 0) { return; }
+            StartValue();
+            builder_->StartDict();
+        }
+        void EndDict() override {
+            if (--depth_ == 0) { return; }
+            builder_->EndDict();
+            EndValue();
+        }
+        void StartArray() override {
+            if (depth_ == 0) { throw json::ParsingError("Error reading JSON data."); }
+            if (depth_++ == 1 && key_ == "base_requests"s) {
+                in_base_requests_ = true;
+                return;
+            }
+            StartValue();
+            builder_->StartArray();
+        }
+        void EndArray() override {
+            if (--depth_ == 1 && in_base_requests_ && !builder_) {
+                in_base_requests_ = false;
+                return;
+            }
+            builder_->EndArray();
+            EndValue();
+        }
+        void Key(std::string key) override {
+            if (depth_ == 1) {
+                key_ = std::move(key);
+                return;
+            }
+            builder_->Key(std::move(key));
+        }
+        void Value(json::Node value) override {
+            if (depth_ == 0) { throw json::ParsingError("Error reading JSON data."); }
+            StartValue();
+            builder_->Value(value);
+            EndValue();
+        }
+
+        size_t GetBaseRequestCount() const {
+            return base_request_count_;
+        }
+        json::Dict TakeRoot() {
+            return std::move(root_);
+        }
+
+    private:
+        void StartValue() {
+            if (!builder_) {
+                builder_.emplace();
+            }
+        }
+        // значение верхнего уровня или элемент base_requests прочитан целиком
+        void EndValue() {
+            if (depth_ != (in_base_requests_ ? 2 : 1)) { return; }
+            json::Node node = builder_->Build();
+            builder_.reset();
+            if (in_base_requests_) {
+                reader_.AddBaseRequest(node);
+                ++base_request_count_;
+            } else {
+                root_[key_] = std::move(node);
+            }
+        }
+
+        JsonReader &reader_;
+        int depth_ = 0;
+        std::string key_;
+        bool in_base_requests_ = false;
+        size_t base_request_count_ = 0;
+        std::optional<json::Builder> builder_;
+        json::Dict root_;
+    };
+
     size_t JsonReader::InputStatReader(std::istream &input) {
-        size_t num = ReadJson(input);
-        if (num == 0) { return num;}
-        size_t result = ParseJsonToRawData();
-        FillTransportCatalogue();
+        size_t result = 0;
+        try {
+            StreamingHandler handler(*this);
+            json::Parse(input, handler);
+            result = handler.GetBaseRequestCount();
+            root_.emplace_back(json::Node{handler.TakeRoot()});
+        } catch (const json::ParsingError &e) {
+            std::cerr << e.what() << std::endl;
+            return 0;
+        }
+        FlushPendingBaseRequests();
+        transport_catalogue_.BuildIndexes();
         routing_settings_ = GetRoutingSettings();
         graph_ptr_ = std::make_unique<TransportCatalogueRouterGraph>(transport_catalogue_, routing_settings_.value());
         return result;
     }
 
-    size_t JsonReader::ParseJsonToRawData() {
-        size_t result = 0;
-        const json::Node &root_node = root_.back().GetRoot();
-        if (!root_node.IsMap()) { throw json::ParsingError("Error reading JSON data.");}
-        const json::Dict &dict = root_node.AsMap();
-        auto iter = dict.find("base_requests");
-        if (iter == dict.end() || !(iter->second.IsArray())) { throw json::ParsingError("Error reading JSON data.");}
-        const json::Array &nodes = iter->second.AsArray();
-        for (const auto &node: nodes) {
-            BaseRequest data = std::move(ParseDataNode(node));
-            if (auto *stop = std::get_if<StopWithDistances>(&data)) {
-                raw_stops_.emplace_back(std::move(*stop));
-            } else if (auto *bus = std::get_if<BusRouteJson>(&data)) {
+    void JsonReader::AddBaseRequest(const json::Node &node) {
+        BaseRequest data = ParseDataNode(node);
+        if (auto *stop = std::get_if<StopWithDistances>(&data)) {
+            AddStopWithDistances(*stop);
+        } else if (auto *bus = std::get_if<BusRouteJson>(&data)) {
+            // пока есть неразрешённые расстояния, длины маршрутов могут измениться - автобус откладывается
+            const bool stops_ready = std::all_of(bus->route_stops.begin(), bus->route_stops.end(), [this](const std::string &stop) {
+                return transport_catalogue_.FindStop(stop).first;
+            });
+            if (stops_ready && pending_distances_.empty()) {
+                AddBusRoute(*bus);
+            } else {
                 raw_buses_.emplace_back(std::move(*bus));
-            } else { throw json::ParsingError("Error reading JSON data.");}
-            ++result;
+            }
+        } else { throw json::ParsingError("Error reading JSON data.");}
+    }
+
+    // Расстояния задаются в том же порядке, что и при чтении всех остановок до расстояний:
+    // сначала отложенные расстояния от ранее прочитанных остановок, затем расстояния самой остановки
+    void JsonReader::AddStopWithDistances(const StopWithDistances &stop) {
+        transport_catalogue_.AddStop(stop);
+        if (auto pending = pending_distances_.find(std::string{stop.stop_name}); pending != pending_distances_.end()) {
+            for (const auto &[from, distance]: pending->second) {
+                transport_catalogue_.SetDistanceBetweenStops(from, stop.stop_name, static_cast<int>(distance));
+            }
+            pending_distances_.erase(pending);
         }
-        return result;
+        for (const auto &[other, distance]: stop.distances) {
+            if (transport_catalogue_.FindStop(other).first) {
+                transport_catalogue_.SetDistanceBetweenStops(stop.stop_name, other, static_cast<int>(distance));
+            } else {
+                pending_distances_[other].push_back({std::string{stop.stop_name}, distance});
+            }
+        }
+    }
+
+    void JsonReader::AddBusRoute(const BusRouteJson &route) const {
+        if (route.route_stops.size() < 2) { return; }
+        transport::BusRoute br;
+        br.bus_name = route.bus_name;
+        br.type = route.type;
+        for (auto &route_stop: route.route_stops) {
+            br.route_stops.emplace_back(&(transport_catalogue_.FindStop(route_stop).second));
+        }
+        transport_catalogue_.AddBus(br);
+    }
+
+    bool JsonReader::FlushPendingBaseRequests() {
+        const bool valid = pending_distances_.empty();
+        pending_distances_.clear();
+        for (const auto &route: raw_buses_) {
+            AddBusRoute(route);
+        }
+        raw_buses_.clear();
+        return valid;
     }
 
     BaseRequest JsonReader::ParseDataStop(const json::Dict &dict) {
@@ -111,29 +246,6 @@ namespace json_reader {
         return {result};
     }
 
-    bool JsonReader::FillTransportCatalogue() {
-        for (const auto &stop: raw_stops_) {
-            transport_catalogue_.AddStop(stop);
-        }
-        for (const auto &stop: raw_stops_) {
-            for (const auto &[other, distance]: stop.distances) {
-                bool valid = transport_catalogue_.SetDistanceBetweenStops(stop.stop_name, other, distance);
-                if (!valid) { return false; }
-            }
-        }
-        for (auto &route: raw_buses_) {
-            if (route.route_stops.size() < 2) { return false; }
-            transport::BusRoute br;
-            br.bus_name = route.bus_name;
-            br.type = route.type;
-            for (auto &route_stop: route.route_stops) {
-                br.route_stops.emplace_back(&(transport_catalogue_.FindStop(route_stop).second));
-            }
-            transport_catalogue_.AddBus(br);
-        }
-        return true;
-    }
-
     size_t JsonReader::OutputStatReader(std::ostream &out) {
         const auto &root_node = root_.back().GetRoot();
         if (!root_node.IsMap()) {
@@ -144,22 +256,111 @@ namespace json_reader {
         if (iter == dict.end() || !(iter->second.IsArray())) {
             throw json::ParsingError("Parsing error.");
         }
-        json::Builder builder;
-        builder.StartArray();
-        for (const json::Node &node: iter->second.AsArray()) {
+        json::Writer writer(out);
+        ProcessRequestBatch(iter->second.AsArray(), writer);
+        return iter->second.AsArray().size();
+    }
+
+    void JsonReader::SetThreadCount(size_t thread_count) {
+        thread_count_ = thread_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : thread_count;
+    }
+
+    // Ответы пишутся в writer по мере обработки запросов. При нескольких потоках запросы распределяются
+    // через общий счётчик, каждый ответ записывается в свою строку и выводится в исходном порядке.
+    // Запросы к справочнику и графу маршрутов только читают данные,
+    // а лениво вычисляемые настройки отрисовки и карта заполняются до запуска потоков.
+    void JsonReader::ProcessRequestBatch(const json::Array &requests, json::Writer &writer) {
+        bool has_map_request = false;
+        for (const json::Node &node: requests) {
             if (!node.IsMap()) {
                 throw json::ParsingError("Node is not a dictionary.");
             }
-            builder.Value(ProcessOneUserRequestNode(node));
+            const auto type_i = node.AsMap().find("type"s);
+            if (type_i != node.AsMap().end() && type_i->second.IsString() && type_i->second.AsString() == "Map"s) {
+                has_map_request = true;
+            }
+        }
+        writer.StartArray();
+        const size_t thread_count = std::min(thread_count_, requests.size());
+        if (thread_count <= 1) {
+            for (const json::Node &request: requests) {
+                ProcessOneUserRequest(request, writer);
+            }
+            writer.EndArray();
+            return;
+        }
+        if (has_map_request) {
+            static_cast<void>(GetRenderedMap());
+        }
+        std::vector<std::string> results(requests.size());
+        std::vector<std::exception_ptr> errors(requests.size());
+        std::atomic<size_t> next_request{0};
+        auto worker = [&]() {
+            for (size_t i = next_request++; i < requests.size(); i = next_request++) {
+                try {
+                    std::ostringstream result;
+                    json::Writer result_writer = writer.MakeValueWriter(result);
+                    ProcessOneUserRequest(requests[i], result_writer);
+                    result_writer.Flush();
+                    results[i] = result.str();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        for (const auto &error: errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        for (std::string &result: results) {
+            writer.RawValue(result);
+            std::string{}.swap(result);
+        }
+        writer.EndArray();
+    }
+
+    // Каждая строка входа - пакет запросов: JSON-массив запросов или словарь с ключом stat_requests.
+    // Ответ на пакет - JSON-массив в одну строку, при ошибке - словарь с ключом error_message.
+    size_t JsonReader::ServeRequests(std::istream &input, std::ostream &output) {
+        size_t result = 0;
+        std::string line;
+        while (std::getline(input, line)) {
+            if (line.find_first_not_of(" \t\r"sv) == std::string::npos) { continue; }
+            std::ostringstream response;
+            try {
+                const json::Document doc = json::Load(line);
+                const json::Node &root_node = doc.GetRoot();
+                json::Writer writer(response, true);
+                if (root_node.IsArray()) {
+                    ProcessRequestBatch(root_node.AsArray(), writer);
+                } else if (const auto *dict = root_node.IsMap() ? &root_node.AsMap() : nullptr;
+                           dict && dict->count("stat_requests"s) && dict->at("stat_requests"s).IsArray()) {
+                    ProcessRequestBatch(dict->at("stat_requests"s).AsArray(), writer);
+                } else { ThrowParsError(); }
+            } catch (const std::exception &e) {
+                // частично записанный ответ отбрасывается
+                response.str(std::string{});
+                json::Writer writer(response, true);
+                writer.StartDict().Key("error_message"sv).Value(std::string_view{e.what()}).EndDict();
+            }
+            output << response.str() << '\n';
+            output.flush();
+            ++result;
         }
-        json::Node res_node = builder.EndArray().Build();
-        svg::RenderContext context(out, 4, 0);
-        context.RenderIndent();
-        json::PrintNode(res_node, context);
-        return res_node.AsArray().size();
+        return result;
     }
 
-    json::Node JsonReader::ProcessOneUserRequestNode(const json::Node &user_request) {
+    void JsonReader::ProcessOneUserRequest(const json::Node &user_request, json::Writer &writer) const {
         if (!user_request.IsMap()) { ThrowParsError();}
         const json::Dict &request_fields = user_request.AsMap();
         int id = -1;
@@ -170,7 +371,12 @@ namespace json_reader {
         if (type_i == request_fields.end() || !(type_i->second.IsString())) { ThrowParsError();}
         std::string type = type_i->second.AsString();
         if (type == "Map"s) {
-            return GenerateMapNode(id);
+            WriteMapResponse(writer, id);
+            return;
+        }
+        if (type == "MapTile"s) {
+            WriteMapTileResponse(writer, id, ParseTileBounds(request_fields));
+            return;
         }
         if (type == "Route"s) {
             std::string from_stop, to_stop;
@@ -180,52 +386,173 @@ namespace json_reader {
             if (const auto to_it = request_fields.find("to"s); to_it != request_fields.end() && to_it->second.IsString()) {
                 to_stop = to_it->second.AsString();
             } else { ThrowParsError();}
-            return GenerateRouteNode(id, from_stop, to_stop);
+            WriteRouteResponse(writer, id, from_stop, to_stop);
+            return;
+        }
+        if (type == "Matrix"s) {
+            std::vector<std::string_view> sources, targets;
+            bool all_found = true;
+            auto read_stops = [this, &request_fields, &all_found](const std::string &key, std::vector<std::string_view> &stops) {
+                const auto it = request_fields.find(key);
+                if (it == request_fields.end() || !it->second.IsArray()) { ThrowParsError();}
+                stops.reserve(it->second.AsArray().size());
+                for (const json::Node &stop: it->second.AsArray()) {
+                    if (!stop.IsString()) { ThrowParsError();}
+                    all_found = all_found && transport_catalogue_.FindStop(stop.AsString()).first;
+                    stops.emplace_back(stop.AsString());
+                }
+            };
+            read_stops("sources"s, sources);
+            read_stops("targets"s, targets);
+            // неизвестная остановка - ответ с ошибкой, как у Route, остальные запросы пакета выполняются
+            if (!all_found) {
+                WriteErrorResponse(writer, id);
+                return;
+            }
+            WriteMatrixResponse(writer, id, sources, targets);
+            return;
+        }
+        if (type == "RouteFromPoint"s) {
+            std::optional<geo::Coordinates> from, to;
+            if (const auto from_it = request_fields.find("from"s); from_it != request_fields.end() && from_it->second.IsMap()) {
+                from = ParseCoordinates(from_it->second.AsMap());
+            }
+            if (const auto to_it = request_fields.find("to"s); to_it != request_fields.end() && to_it->second.IsMap()) {
+                to = ParseCoordinates(to_it->second.AsMap());
+            }
+            if (!from || !to) { ThrowParsError();}
+            WriteRouteFromPointResponse(writer, id, *from, *to);
+            return;
+        }
+        if (type == "NearestStops"s) {
+            const auto point = ParseCoordinates(request_fields);
+            if (!point) { ThrowParsError();}
+            int count = 0;
+            if (const auto count_it = request_fields.find("count"s); count_it != request_fields.end() && count_it->second.IsInt()) {
+                count = count_it->second.AsInt();
+            } else { ThrowParsError();}
+            if (count < 0) { ThrowParsError();}
+            WriteNearestStopsResponse(writer, id, *point, static_cast<size_t>(count));
+            return;
+        }
+        if (type == "StopsInBox"s) {
+            std::optional<geo::Coordinates> min, max;
+            if (const auto min_it = request_fields.find("min"s); min_it != request_fields.end() && min_it->second.IsMap()) {
+                min = ParseCoordinates(min_it->second.AsMap());
+            }
+            if (const auto max_it = request_fields.find("max"s); max_it != request_fields.end() && max_it->second.IsMap()) {
+                max = ParseCoordinates(max_it->second.AsMap());
+            }
+            if (!min || !max) { ThrowParsError();}
+            WriteStopsInBoxResponse(writer, id, *min, *max);
+            return;
         }
         std::string name;
         if (const auto name_i = request_fields.find("name"s); name_i != request_fields.end() && name_i->second.IsString()) {
             name = name_i->second.AsString();
         } else { ThrowParsError();}
         if (type == "Bus"s) {
-            return GenerateBusNode(id, name);
+            WriteBusResponse(writer, id, name);
+        } else if (type == "Stop"s) {
+            WriteStopResponse(writer, id, name);
+        } else {
+            ThrowParsError();
         }
-        if (type == "Stop"s) {
-            return GenerateStopNode(id, name);
+    }
+
+    // Ключи ответов пишутся в алфавитном порядке, как их печатал json::PrintNode из std::map
+
+    void JsonReader::WriteMapResponse(json::Writer &writer, int id) const {
+        writer.StartDict().Key("map"sv).RawValue(GetRenderedMap()).Key("request_id"sv).Value(id).EndDict();
+    }
+
+    const std::string &JsonReader::GetRenderedMap() const {
+        if (rendered_map_) {
+            return *rendered_map_;
         }
-        ThrowParsError();
-        return {};
+        const RendererSettings rs = GetRendererSetting();
+        MapRenderer mr(rs);
+        std::ostringstream svg;
+        mr.RenderSvgMap(transport_catalogue_, svg);
+        std::ostringstream escaped;
+        {
+            json::Writer map_writer(escaped, true);
+            map_writer.Value(std::string_view{svg.str()});
+        }
+        return rendered_map_.emplace(escaped.str());
     }
 
-    json::Node JsonReader::GenerateMapNode(int id) const {
-        RendererSettings rs = GetRendererSetting();
+    void JsonReader::WriteMapTileResponse(json::Writer &writer, int id, const TileBounds &bounds) const {
+        const RendererSettings rs = GetRendererSetting();
         MapRenderer mr(rs);
-        std::ostringstream stream;
-        mr.RenderSvgMap(transport_catalogue_, stream);
-        return json::Builder().StartDict().Key("request_id"s).Value(id).Key("map"s).Value(
-                std::move(stream.str())).EndDict().Build();
+        std::ostringstream svg;
+        mr.RenderSvgTile(transport_catalogue_, bounds, svg);
+        writer.StartDict().Key("map"sv).Value(std::string_view{svg.str()}).Key("request_id"sv).Value(id).EndDict();
     }
 
-    json::Node JsonReader::GenerateBusNode(int id, std::string &name) const {
+    void JsonReader::WriteBusResponse(json::Writer &writer, int id, std::string_view name) const {
         BusInfo bi = transport_catalogue_.GetBusInfo(name);
-        if (bi.route_type == RouteType::NOT_SET) {return GetErrorNode(id);}
-        return json::Builder().StartDict().Key("request_id"s).Value(id).Key("curvature"s).Value(bi.curvature)
-                .Key("route_length"s).Value(static_cast<double>(bi.route_length)).Key("stop_count"s).Value(static_cast<int>(bi.stops_number))
-                .Key("unique_stop_count"s).Value(static_cast<int>(bi.unique_stops_counter)).EndDict().Build();
+        if (bi.route_type == RouteType::NOT_SET) {
+            WriteErrorResponse(writer, id);
+            return;
+        }
+        writer.StartDict().Key("curvature"sv).Value(bi.curvature).Key("request_id"sv).Value(id)
+                .Key("route_length"sv).Value(static_cast<double>(bi.route_length)).Key("stop_count"sv).Value(static_cast<int>(bi.stops_number))
+                .Key("unique_stop_count"sv).Value(static_cast<int>(bi.unique_stops_counter)).EndDict();
+    }
+
+    void JsonReader::WriteStopResponse(json::Writer &writer, int id, std::string_view name) const {
+        if (!transport_catalogue_.FindStop(name).first) {
+            WriteErrorResponse(writer, id);
+            return;
+        }
+        writer.StartDict().Key("buses"sv).StartArray();
+        for (const uint32_t bus_id: transport_catalogue_.GetBusesForStop(name)) {
+            writer.Value(transport_catalogue_.GetBusNameById(bus_id));
+        }
+        writer.EndArray().Key("request_id"sv).Value(id).EndDict();
+    }
+
+    void JsonReader::WriteNearestStopsResponse(json::Writer &writer, int id, geo::Coordinates point, size_t count) const {
+        writer.StartDict().Key("request_id"sv).Value(id).Key("stops"sv).StartArray();
+        for (const auto& [stop, distance]: transport_catalogue_.FindNearestStops(point, count)) {
+            writer.StartDict().Key("distance"sv).Value(distance).Key("name"sv).Value(stop->stop_name).EndDict();
+        }
+        writer.EndArray().EndDict();
     }
 
-    json::Node JsonReader::GenerateStopNode(int id, std::string &name) const {
-        if (!transport_catalogue_.FindStop(name).first) { return GetErrorNode(id);}
-        json::Dict result;
-        json::Array buses;
-        json::Builder builder;
-        builder.StartDict().Key("buses"s).StartArray();
-        const std::set<std::string_view> &bus_routes = transport_catalogue_.GetBusesForStop(name);
-        for (auto bus_route: bus_routes) {
-            builder.Value(std::move(std::string{bus_route}));
+    void JsonReader::WriteStopsInBoxResponse(json::Writer &writer, int id, geo::Coordinates min, geo::Coordinates max) const {
+        writer.StartDict().Key("request_id"sv).Value(id).Key("stops"sv).StartArray();
+        for (const Stop *stop: transport_catalogue_.FindStopsInBox(min, max)) {
+            writer.Value(stop->stop_name);
         }
-        builder.EndArray();
-        builder.Key("request_id"s).Value(id).EndDict();
-        return builder.Build();
+        writer.EndArray().EndDict();
+    }
+
+    TileBounds JsonReader::ParseTileBounds(const json::Dict &request_fields) {
+        const auto min_it = request_fields.find("min"s);
+        const auto max_it = request_fields.find("max"s);
+        if (min_it != request_fields.end() || max_it != request_fields.end()) {
+            std::optional<geo::Coordinates> min, max;
+            if (min_it != request_fields.end() && min_it->second.IsMap()) {
+                min = ParseCoordinates(min_it->second.AsMap());
+            }
+            if (max_it != request_fields.end() && max_it->second.IsMap()) {
+                max = ParseCoordinates(max_it->second.AsMap());
+            }
+            if (!min || !max || min->latitude > max->latitude || min->longitude > max->longitude) { ThrowParsError();}
+            return {*min, *max};
+        }
+        int tile[3] = {0, 0, 0};
+        const std::string keys[3] = {"zoom"s, "x"s, "y"s};
+        for (size_t i = 0; i < 3; ++i) {
+            const auto it = request_fields.find(keys[i]);
+            if (it == request_fields.end() || !it->second.IsInt() || it->second.AsInt() < 0) { ThrowParsError();}
+            tile[i] = it->second.AsInt();
+        }
+        const auto [zoom, x, y] = tile;
+        if (static_cast<uint32_t>(zoom) > MAX_TILE_ZOOM || x >= (1 << zoom) || y >= (1 << zoom)) { ThrowParsError();}
+        return GetTileBounds(zoom, x, y);
     }
 
     void JsonReader::ThrowParsError() {
@@ -291,6 +618,10 @@ namespace json_reader {
                 settings.color_palette.emplace_back(color);
             }
         } else { ThrowParsError();}
+        if (const auto field_iter = render_settings.find("line_simplification_tolerance"s); field_iter != render_settings.end()) {
+            if (!field_iter->second.IsDouble() || field_iter->second.AsDouble() < 0) { ThrowParsError();}
+            settings.line_simplification_tolerance = field_iter->second.AsDouble();
+        }
         renderer_settings_.emplace(settings);
         return settings;
     }
@@ -312,36 +643,93 @@ namespace json_reader {
         if (const auto &bus_velocity = routing_settings.find("bus_velocity"); bus_velocity != routing_settings.end() && bus_velocity->second.IsDouble()) {
             settings.bus_velocity = bus_velocity->second.AsDouble();
         } else { ThrowParsError();}
+        if (const auto &router_type = routing_settings.find("router_type"); router_type != routing_settings.end()) {
+            if (!router_type->second.IsString()) { ThrowParsError();}
+            settings.router_type = GetRouterType(router_type->second.AsString());
+        }
+        if (const auto &graph_model = routing_settings.find("graph_model"); graph_model != routing_settings.end()) {
+            if (!graph_model->second.IsString()) { ThrowParsError();}
+            settings.graph_model = GetGraphModel(graph_model->second.AsString());
+        }
+        if (const auto &pedestrian_velocity = routing_settings.find("pedestrian_velocity"); pedestrian_velocity != routing_settings.end()) {
+            if (!pedestrian_velocity->second.IsDouble() || pedestrian_velocity->second.AsDouble() <= 0) { ThrowParsError();}
+            settings.pedestrian_velocity = pedestrian_velocity->second.AsDouble();
+        }
+        if (const auto &walk_stop_count = routing_settings.find("walk_stop_count"); walk_stop_count != routing_settings.end()) {
+            if (!walk_stop_count->second.IsInt() || walk_stop_count->second.AsInt() <= 0) { ThrowParsError();}
+            settings.walk_stop_count = walk_stop_count->second.AsInt();
+        }
         routing_settings_.emplace(settings);
         return settings;
     }
 
-    json::Node JsonReader::GenerateRouteNode(int id, std::string_view from, std::string_view to) const {
+    void JsonReader::WriteRouteResponse(json::Writer &writer, int id, std::string_view from, std::string_view to) const {
         const auto &[found_from, from_stop] = transport_catalogue_.FindStop(from);
         const auto &[found_to, to_stop] = transport_catalogue_.FindStop(to);
         if (!found_from || !found_to) { ThrowParsError();}
         auto route = graph_ptr_->BuildRoute(from, to);
-        if (!route) { return GetErrorNode(id); }
-        json::Builder builder;
-        builder.StartDict().Key("request_id"s).Value(id).Key("total_time"s).Value(route->weight).Key("items"s).StartArray();
+        if (!route) {
+            WriteErrorResponse(writer, id);
+            return;
+        }
+        writer.StartDict().Key("items"sv).StartArray();
+        WriteRouteItems(writer, *route);
+        writer.EndArray().Key("request_id"sv).Value(id).Key("total_time"sv).Value(route->weight).EndDict();
+    }
+
+    // Только веса маршрутов, строка на каждый источник; null - маршрута нет
+    void JsonReader::WriteMatrixResponse(json::Writer &writer, int id, const std::vector<std::string_view> &sources,
+                                         const std::vector<std::string_view> &targets) const {
+        const auto times = graph_ptr_->BuildTimeMatrix(sources, targets);
+        writer.StartDict().Key("request_id"sv).Value(id).Key("times"sv).StartArray();
+        for (size_t source = 0; source < sources.size(); ++source) {
+            writer.StartArray();
+            for (size_t target = 0; target < targets.size(); ++target) {
+                if (const auto &time = times[source * targets.size() + target]) {
+                    writer.Value(*time);
+                } else {
+                    writer.Value(nullptr);
+                }
+            }
+            writer.EndArray();
+        }
+        writer.EndArray().EndDict();
+    }
+
+    void JsonReader::WriteRouteItems(json::Writer &writer, const graph::Router<double>::RouteInfo &route) const {
         double waiting_time = graph_ptr_->GetBusWaitingTime();
-        for (const auto &edge_id: route->edges) {
-            const graph::Edge<double> &edge = graph_ptr_->GetEdge(edge_id);
-            auto link = graph_ptr_->GetLinkById(edge_id);
-            const auto &stop_from = graph_ptr_->GetStopById(edge.from);
-            json::Builder wait_builder;
-            wait_builder.StartDict().Key("type"s).Value("Wait"s)
-                    .Key("stop_name"s).Value(std::string{stop_from.stop_name})
-                    .Key("time"s).Value(waiting_time).EndDict();
-            builder.Value(wait_builder.Build());
-            json::Builder bus_builder;
-            double time = edge.weight - waiting_time;
-            bus_builder.StartDict().Key("type"s).Value("Bus"s).Key("bus"s).Value(std::string{link.bus_name})
-                    .Key("span_count"s).Value(static_cast<int>(link.number_of_stops)).Key("time"s).Value(time).EndDict();
-            builder.Value(bus_builder.Build());
-        }
-        builder.EndArray().EndDict();
-        return builder.Build();
+        for (const auto &leg: graph_ptr_->GetRouteLegs(route)) {
+            writer.StartDict().Key("stop_name"sv).Value(leg.stop_name)
+                    .Key("time"sv).Value(waiting_time).Key("type"sv).Value("Wait"sv).EndDict();
+            writer.StartDict().Key("bus"sv).Value(leg.bus_name).Key("span_count"sv).Value(leg.span_count)
+                    .Key("time"sv).Value(leg.time).Key("type"sv).Value("Bus"sv).EndDict();
+        }
+    }
+
+    // У пешего участка нет ключа from (to), если он начинается (заканчивается) в точке запроса
+    void JsonReader::WriteWalkItem(json::Writer &writer, const WalkLeg &walk) {
+        writer.StartDict().Key("distance"sv).Value(walk.distance);
+        if (!walk.from_stop.empty()) {
+            writer.Key("from"sv).Value(walk.from_stop);
+        }
+        writer.Key("time"sv).Value(walk.time);
+        if (!walk.to_stop.empty()) {
+            writer.Key("to"sv).Value(walk.to_stop);
+        }
+        writer.Key("type"sv).Value("Walk"sv).EndDict();
+    }
+
+    void JsonReader::WriteRouteFromPointResponse(json::Writer &writer, int id, geo::Coordinates from, geo::Coordinates to) const {
+        const PointRoute route = graph_ptr_->BuildRouteFromPoint(from, to);
+        writer.StartDict().Key("items"sv).StartArray();
+        WriteWalkItem(writer, route.first_walk);
+        if (route.ride) {
+            WriteRouteItems(writer, *route.ride);
+        }
+        if (route.last_walk) {
+            WriteWalkItem(writer, *route.last_walk);
+        }
+        writer.EndArray().Key("request_id"sv).Value(id).Key("total_time"sv).Value(route.total_time).EndDict();
     }
 
     SerializationSettings JsonReader::GetSerializationSettings() const {
@@ -355,22 +743,66 @@ namespace json_reader {
         if (const auto &file_name = serialization_settings.find("file"); file_name != serialization_settings.end() && file_name->second.IsString()) {
             result.file_name = file_name->second.AsString();
         } else { throw json::ParsingError("Error while parsing serialization settings."); }
+        if (const auto &router_file = serialization_settings.find("router_file"); router_file != serialization_settings.end()) {
+            if (!router_file->second.IsString()) { throw json::ParsingError("Error while parsing serialization settings."); }
+            result.router_file = router_file->second.AsString();
+        }
         return std::move(result);
     }
 
     void JsonReader::SaveToReader(tc_serialize::TransportCatalogue &t_cat) const {
         *t_cat.mutable_render_settings() = std::move(SerializeRendererSettings(GetRendererSetting()));
         *(t_cat.mutable_router_settings()->mutable_routing_settings()) = std::move(SerializeRouting(GetRoutingSettings()));
-        graph_ptr_->SaveTo(t_cat);
+        const SerializationSettings settings = GetSerializationSettings();
+        if (settings.router_file.empty()) {
+            graph_ptr_->SaveTo(t_cat);
+        } else {
+            graph_ptr_->SaveToMapped(t_cat, settings.router_file);
+        }
     }
 
     bool JsonReader::RestoreFrom(tc_serialize::TransportCatalogue &t_cat) {
         renderer_settings_.emplace(DeserializeRenderSetting(t_cat.render_settings()));
         routing_settings_.emplace(DeserializeRouting(t_cat.router_settings().routing_settings()));
-        graph_ptr_ = std::make_unique<TransportCatalogueRouterGraph>(transport_catalogue_, routing_settings_.value(), t_cat);
+        const std::string& stored_router_file = t_cat.router_settings().router_file();
+        if (stored_router_file.empty()) {
+            graph_ptr_ = std::make_unique<TransportCatalogueRouterGraph>(transport_catalogue_, routing_settings_.value(), t_cat);
+            return true;
+        }
+        // файл из serialization_settings запроса имеет приоритет над именем, записанным в базу
+        std::string router_file = root_.empty() ? std::string{} : GetSerializationSettings().router_file;
+        if (router_file.empty()) {
+            router_file = stored_router_file;
+        }
+        graph_ptr_ = std::make_unique<TransportCatalogueRouterGraph>(transport_catalogue_, routing_settings_.value(), t_cat, router_file);
         return true;
     }
 
+    graph::RouterType JsonReader::GetRouterType(const std::string& name) {
+        if (name == "all_pairs"s) {
+            return graph::RouterType::ALL_PAIRS;
+        }
+        if (name == "bidirectional_dijkstra"s) {
+            return graph::RouterType::BIDIRECTIONAL_DIJKSTRA;
+        }
+        if (name == "contraction_hierarchies"s) {
+            return graph::RouterType::CONTRACTION_HIERARCHIES;
+        }
+        ThrowParsError();
+        return {};
+    }
+
+    GraphModel JsonReader::GetGraphModel(const std::string& name) {
+        if (name == "stop_pairs"s) {
+            return GraphModel::STOP_PAIRS;
+        }
+        if (name == "ride_vertices"s) {
+            return GraphModel::RIDE_VERTICES;
+        }
+        ThrowParsError();
+        return {};
+    }
+
     svg::Color JsonReader::GetColor(const Node& node) {
         if (node.IsString()) {
             return node.AsString();
@@ -389,9 +821,7 @@ namespace json_reader {
         } return {};
     }
 
-    inline json::Node JsonReader::GetErrorNode(int id) {
-        return json::Builder().StartDict().Key("request_id"s).Value(id)
-                .Key("error_message"s).Value("not found"s).EndDict()
-                .Build();
+    void JsonReader::WriteErrorResponse(json::Writer &writer, int id) {
+        writer.StartDict().Key("error_message"sv).Value("not found"sv).Key("request_id"sv).Value(id).EndDict();
     }
 } // namespace json_reader
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <vector>
 #include "json.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "transport_catalogue.pb.h"
 #include "map_renderer.h"
@@ -32,33 +33,59 @@ namespace json_reader {
         size_t ReadJson(std::istream &input);
         size_t InputStatReader(std::istream &input);
         size_t OutputStatReader(std::ostream &output);
+        size_t ServeRequests(std::istream &input, std::ostream &output);
+        // Число потоков для обработки stat_requests, 0 - по числу ядер, по умолчанию 1 (последовательно)
+        void SetThreadCount(size_t thread_count);
         [[nodiscard]] RendererSettings GetRendererSetting() const;
         RoutingSettings GetRoutingSettings() const;
         SerializationSettings GetSerializationSettings() const;
         void SaveToReader(tc_serialize::TransportCatalogue &t_cat) const;
         bool RestoreFrom(tc_serialize::TransportCatalogue &t_cat);
-        static inline json::Node GetErrorNode(int id) ;
     private:
         mutable std::optional<RoutingSettings> routing_settings_;
         mutable std::optional<RendererSettings> renderer_settings_;
+        // карта уже в виде строки JSON (в кавычках, экранированная): справочник после загрузки не меняется,
+        // поэтому карта рисуется один раз, а следующие запросы Map только копируют строку
+        mutable std::optional<std::string> rendered_map_;
         transport::TransportCatalogue &transport_catalogue_;
         std::vector<json::Document> root_;
-        std::vector<transport::StopWithDistances> raw_stops_;
+        // расстояния до ещё не прочитанных остановок: остановка назначения -> (откуда, расстояние)
+        std::unordered_map<std::string, std::vector<transport::StopDistanceData>> pending_distances_;
+        // автобусы, которые нельзя добавить в справочник, пока не прочитаны все их остановки и расстояния
         std::vector<BusRouteJson> raw_buses_;
         std::unique_ptr<TransportCatalogueRouterGraph> graph_ptr_;
-        json::Node ProcessOneUserRequestNode(const json::Node &user_request);
-        json::Node GenerateMapNode(int id) const;
-        json::Node GenerateBusNode(int id, std::string &name) const;
-        json::Node GenerateStopNode(int id, std::string &name) const;
-        json::Node GenerateRouteNode(int id, std::string_view from, std::string_view to) const;
+        size_t thread_count_ = 1;
+        void ProcessOneUserRequest(const json::Node &user_request, json::Writer &writer) const;
+        void ProcessRequestBatch(const json::Array &requests, json::Writer &writer);
+        void WriteMapResponse(json::Writer &writer, int id) const;
+        const std::string &GetRenderedMap() const;
+        void WriteMapTileResponse(json::Writer &writer, int id, const TileBounds &bounds) const;
+        void WriteBusResponse(json::Writer &writer, int id, std::string_view name) const;
+        void WriteStopResponse(json::Writer &writer, int id, std::string_view name) const;
+        void WriteRouteResponse(json::Writer &writer, int id, std::string_view from, std::string_view to) const;
+        void WriteRouteFromPointResponse(json::Writer &writer, int id, geo::Coordinates from, geo::Coordinates to) const;
+        void WriteMatrixResponse(json::Writer &writer, int id, const std::vector<std::string_view> &sources,
+                                 const std::vector<std::string_view> &targets) const;
+        void WriteRouteItems(json::Writer &writer, const graph::Router<double>::RouteInfo &route) const;
+        static void WriteWalkItem(json::Writer &writer, const WalkLeg &walk);
+        void WriteNearestStopsResponse(json::Writer &writer, int id, geo::Coordinates point, size_t count) const;
+        void WriteStopsInBoxResponse(json::Writer &writer, int id, geo::Coordinates min, geo::Coordinates max) const;
+        static void WriteErrorResponse(json::Writer &writer, int id);
         json::Dict GetDictForRenderSettings() const;
-        size_t ParseJsonToRawData();
+        class StreamingHandler;
+        void AddBaseRequest(const json::Node &node);
+        void AddStopWithDistances(const transport::StopWithDistances &stop);
+        void AddBusRoute(const BusRouteJson &route) const;
+        bool FlushPendingBaseRequests();
         static BaseRequest ParseDataNode(const json::Node &node);
-        bool FillTransportCatalogue();
         static std::optional<geo::Coordinates> ParseCoordinates(const json::Dict &dict);
+        // границы плитки из ключей min и max (словари координат) или zoom, x и y
+        static TileBounds ParseTileBounds(const json::Dict &request_fields);
         static BaseRequest ParseDataStop(const json::Dict &dict);
         static BaseRequest ParseDataBus(const json::Dict &dict);
         static svg::Color GetColor(const Node& node);
+        static graph::RouterType GetRouterType(const std::string& name);
+        static GraphModel GetGraphModel(const std::string& name);
         static void ThrowParsError();
         static double CheckSettingParam(json::Dict& settings, std::string&& str);
     };
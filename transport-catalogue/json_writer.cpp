@@ -0,0 +1,229 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace json {
+    namespace {
+        constexpr int INDENT_STEP = 4;
+        // размер буфера, после которого накопленный текст сбрасывается в поток
+        constexpr size_t FLUSH_SIZE = 64 * 1024;
+    }
+
+    Writer::Writer(std::ostream& out, bool compact, int indent)
+            : out_(out), compact_(compact), indent_(indent) {
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    Writer& Writer::StartDict() {
+        BeginValue();
+        buffer_.push_back('{');
+        levels_.push_back({true, true});
+        return *this;
+    }
+
+    Writer& Writer::EndDict() {
+        if (levels_.empty() || !levels_.back().is_dict || key_written_) {
+            throw std::logic_error("You end dict either in empty object or not in dict");
+        }
+        levels_.pop_back();
+        NewLine(ValueIndent());
+        buffer_.push_back('}');
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::StartArray() {
+        BeginValue();
+        buffer_.push_back('[');
+        levels_.push_back({false, true});
+        return *this;
+    }
+
+    Writer& Writer::EndArray() {
+        if (levels_.empty() || levels_.back().is_dict) {
+            throw std::logic_error("You end array either in empty object or not in array");
+        }
+        levels_.pop_back();
+        NewLine(ValueIndent());
+        buffer_.push_back(']');
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Key(std::string_view key) {
+        if (levels_.empty() || !levels_.back().is_dict || key_written_) {
+            throw std::logic_error("You try to insert key either in ready object or not in dict");
+        }
+        if (!levels_.back().empty) {
+            buffer_.push_back(',');
+        }
+        levels_.back().empty = false;
+        NewLine(ValueIndent());
+        WriteString(key);
+        buffer_.append(compact_ ? ":" : ": ");
+        key_written_ = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(std::nullptr_t) {
+        BeginValue();
+        buffer_.append("null");
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value) {
+        BeginValue();
+        buffer_.append(value ? "true" : "false");
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value) {
+        BeginValue();
+        char digits[16];
+        const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+        buffer_.append(digits, end);
+        EndValue();
+        return *this;
+    }
+
+    // формат совпадает с выводом double в std::ostream с настройками по умолчанию ("%g", 6 значащих цифр)
+    Writer& Writer::Value(double value) {
+        BeginValue();
+        char digits[32];
+        const auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value, std::chars_format::general, 6);
+        buffer_.append(digits, end);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value) {
+        BeginValue();
+        WriteString(value);
+        EndValue();
+        return *this;
+    }
+
+    Writer& Writer::Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const Node& node) {
+        if (node.IsNull()) {
+            return Value(nullptr);
+        }
+        if (node.IsBool()) {
+            return Value(node.AsBool());
+        }
+        if (node.IsInt()) {
+            return Value(node.AsInt());
+        }
+        if (node.IsPureDouble()) {
+            return Value(node.AsDouble());
+        }
+        if (node.IsString()) {
+            return Value(std::string_view(node.AsString()));
+        }
+        if (node.IsArray()) {
+            StartArray();
+            for (const Node& item: node.AsArray()) {
+                Value(item);
+            }
+            return EndArray();
+        }
+        StartDict();
+        for (const auto& [key, value]: node.AsMap()) {
+            Key(key);
+            Value(value);
+        }
+        return EndDict();
+    }
+
+    Writer& Writer::RawValue(std::string_view json) {
+        BeginValue();
+        buffer_.append(json);
+        EndValue();
+        return *this;
+    }
+
+    Writer Writer::MakeValueWriter(std::ostream& out) const {
+        return Writer(out, compact_, ValueIndent());
+    }
+
+    void Writer::Flush() {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    void Writer::BeginValue() {
+        if (buffer_.size() >= FLUSH_SIZE) {
+            Flush();
+        }
+        if (levels_.empty()) {
+            if (root_written_) {
+                throw std::logic_error("You try to add value to ready object");
+            }
+            return;
+        }
+        Level& level = levels_.back();
+        if (level.is_dict) {
+            if (!key_written_) {
+                throw std::logic_error("You try to add value in dict without key");
+            }
+            key_written_ = false;
+            return;
+        }
+        if (!level.empty) {
+            buffer_.push_back(',');
+        }
+        level.empty = false;
+        NewLine(ValueIndent());
+    }
+
+    void Writer::EndValue() {
+        if (levels_.empty()) {
+            root_written_ = true;
+        }
+    }
+
+    void Writer::NewLine(int indent) {
+        if (compact_) {
+            return;
+        }
+        buffer_.push_back('\n');
+        buffer_.append(static_cast<size_t>(indent), ' ');
+    }
+
+    // экранирование совпадает с PrintValue для строк
+    void Writer::WriteString(std::string_view str) {
+        buffer_.push_back('"');
+        for (const char c: str) {
+            switch (c) {
+                case '"':
+                    buffer_.append("\\\"");
+                    break;
+                case '\r':
+                    buffer_.append("\\r");
+                    break;
+                case '\n':
+                    buffer_.append("\\n");
+                    break;
+                case '\\':
+                    buffer_.append("\\\\");
+                    break;
+                default:
+                    buffer_.push_back(c);
+            }
+        }
+        buffer_.push_back('"');
+    }
+
+    int Writer::ValueIndent() const {
+        return indent_ + INDENT_STEP * static_cast<int>(levels_.size());
+    }
+}  // namespace json
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.h"
+
+namespace json {
+
+/*
+ * Потоковая запись JSON без построения дерева Node: значения сразу попадают в буфер,
+ * который сбрасывается в поток порциями. Отступы и порядок элементов совпадают с PrintNode,
+ * ключи словаря пишутся в том порядке, в котором их передали (PrintNode сортирует их, как std::map).
+ */
+    class Writer {
+    public:
+        // compact - печать в одну строку, indent - отступ, на котором стоит записываемое значение
+        explicit Writer(std::ostream& out, bool compact = false, int indent = 0);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer();
+
+        Writer& StartDict();
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+        Writer& Key(std::string_view key);
+
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const char* value);
+        Writer& Value(const Node& node);
+        // Значение, уже записанное другим Writer, созданным через MakeValueWriter
+        Writer& RawValue(std::string_view json);
+
+        // Writer для следующего значения текущего уровня с тем же форматированием, например для записи в другом потоке
+        Writer MakeValueWriter(std::ostream& out) const;
+        void Flush();
+
+    private:
+        struct Level {
+            bool is_dict;
+            bool empty;
+        };
+
+        void BeginValue();
+        void EndValue();
+        void NewLine(int indent);
+        void WriteString(std::string_view str);
+        int ValueIndent() const;
+
+        std::ostream& out_;
+        std::string buffer_;
+        std::vector<Level> levels_;
+        bool compact_;
+        int indent_;
+        bool key_written_ = false;
+        bool root_written_ = false;
+    };
+}  // namespace json
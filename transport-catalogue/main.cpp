@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <string>
 #include "json_reader.h"
+#include "request_server.h"
 #include "transport_catalogue.h"
 //#define JSON_TEST1
 /*
@@ -19,15 +22,50 @@ using namespace std::literals;
 
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests] [--threads=N]\n"sv;
+    stream << "       transport_catalogue serve <base_file> [socket_path] [--threads=N]\n"sv;
+}
+
+bool LoadBase(TransportCatalogue& tc, JsonReader& jr, const std::string& file_name) {
+    tc_serialize::TransportCatalogue ser_tc;
+    std::ifstream input(file_name, std::ios::binary | std::ios::in);
+    if (!input || !ser_tc.ParseFromIstream(&input)) {
+        return false;
+    }
+    tc.RestoreFromSerializedTransportCat(ser_tc);
+    jr.RestoreFrom(ser_tc);
+    return true;
 }
 
 int main(int argc, char* argv[]) {
     TransportCatalogue tc;
     JsonReader jr(tc);
+    // необязательный ключ --threads=N в любой позиции: число потоков для обработки запросов, 0 - по числу ядер
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg.substr(0, "--threads="sv.size()) == "--threads="sv) {
+            jr.SetThreadCount(std::stoul(std::string{arg.substr("--threads="sv.size())}));
+            std::copy(argv + i + 1, argv + argc, argv + i);
+            --argc;
+            break;
+        }
+    }
     //jr.InputStatReader(std::cin);
     //jr.OutputStatReader(std::cout);
 
+    if (argc >= 3 && argv[1] == "serve"sv) {
+        // база загружается один раз, пакеты запросов читаются построчно из stdin или сокета
+        if (argc > 4 || !LoadBase(tc, jr, argv[2])) {
+            PrintUsage();
+            return 1;
+        }
+        if (argc == 4) {
+            request_server::ServeUnixSocket(jr, argv[3]);
+        } else {
+            jr.ServeRequests(std::cin, std::cout);
+        }
+        return 0;
+    }
     if (argc != 2) {
         PrintUsage();
         return 1;
@@ -46,13 +84,8 @@ int main(int argc, char* argv[]) {
 
     } else if (mode == "process_requests"sv) {
         jr.ReadJson(std::cin);
-        tc_serialize::TransportCatalogue ser_tc;
         SerializationSettings settings = jr.GetSerializationSettings();
-        std::ifstream input(settings.file_name, std::ios::binary | std::ios::in);
-        ser_tc.ParseFromIstream(&input);
-
-        tc.RestoreFromSerializedTransportCat(ser_tc);
-        jr.RestoreFrom(ser_tc);
+        LoadBase(tc, jr, settings.file_name);
         jr.OutputStatReader(std::cout);
     } else {
         PrintUsage();
@@ -1,15 +1,89 @@
 #include "map_renderer.h"
 #include "domain.h"
 
+#include <cmath>
+#include <stdexcept>
+
 using namespace std::literals;
 
+namespace {
+    const double PI = 3.14159265358979323846;
+
+    // Расстояние от точки до отрезка [from, to] на изображении
+    double DistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+        const double dx = to.x - from.x;
+        const double dy = to.y - from.y;
+        const double length_squared = dx * dx + dy * dy;
+        double t = 0;
+        if (length_squared > 0) {
+            t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0., 1.);
+        }
+        return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+    }
+
+    // Алгоритм Дугласа-Пекера: оставляет концы ломаной и точки, отклонение которых от упрощённой линии больше tolerance.
+    // Расстояние до отрезка, а не до прямой, чтобы не терять точки замкнутых маршрутов
+    std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance) {
+        if (points.size() < 3) {
+            return points;
+        }
+        std::vector<bool> keep(points.size(), false);
+        keep.front() = true;
+        keep.back() = true;
+        std::vector<std::pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+        while (!ranges.empty()) {
+            const auto [first, last] = ranges.back();
+            ranges.pop_back();
+            double max_distance = 0;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; ++i) {
+                const double distance = DistanceToSegment(points[i], points[first], points[last]);
+                if (distance > max_distance) {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (max_distance <= tolerance) {
+                continue;
+            }
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+        std::vector<svg::Point> result;
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (keep[i]) {
+                result.push_back(points[i]);
+            }
+        }
+        return result;
+    }
+}
+
+TileBounds GetTileBounds(uint32_t zoom, uint32_t x, uint32_t y) {
+    if (zoom > MAX_TILE_ZOOM) {
+        throw std::out_of_range("Tile zoom is too large");
+    }
+    const double tile_count = std::ldexp(1., static_cast<int>(zoom));
+    if (x >= tile_count || y >= tile_count) {
+        throw std::out_of_range("Tile is out of range");
+    }
+    const auto longitude = [tile_count](double tile_x) {
+        return tile_x / tile_count * 360. - 180.;
+    };
+    const auto latitude = [tile_count](double tile_y) {
+        return std::atan(std::sinh(PI * (1. - 2. * tile_y / tile_count))) * 180. / PI;
+    };
+    return {{latitude(y + 1.), longitude(x)}, {latitude(y), longitude(x + 1.)}};
+}
+
 svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
     return {(coords.longitude - min_lon_) * zoom_coeff_ + padding_,
             (max_lat_ - coords.latitude) * zoom_coeff_ + padding_
     };
 }
 
-void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, svg::Document& svg_doc) {
+void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, svg::PackedDocument& svg_doc) {
     const std::map<std::string_view, const transport::Stop*> stops = tc.GetAllStopsIndex();
     stops_ = &stops;
     std::vector<geo::Coordinates> all_route_stops_coordinates;
@@ -19,8 +93,71 @@ void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, svg::Doc
     }
     SphereProjector projector(all_route_stops_coordinates.begin(), all_route_stops_coordinates.end(),settings_.width, settings_.height, settings_.padding);
     projector_ = &projector;
-    const std::map<std::string_view, const transport::BusRoute*> routes = tc.GetAllRoutesIndex();
+    std::vector<DrawnRoute> routes;
+    for (const uint32_t bus_id : tc.GetBusesByName()) {
+        const transport::BusRoute& route = tc.GetBusById(bus_id);
+        if (route.route_stops.empty()) { continue; }
+        routes.push_back({&route, GetColorIndex(tc.GetRouteOrder(bus_id)), {}});
+    }
     routes_ = &routes;
+    RenderLayers(tc, svg_doc);
+}
+
+void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, std::ostream& out) {
+    svg::PackedDocument svg_doc;
+    RenderSvgMap(tc, svg_doc);
+    svg_doc.Render(out);
+}
+
+void MapRenderer::RenderSvgTile(const transport::TransportCatalogue& tc, const TileBounds& bounds, svg::PackedDocument& svg_doc) {
+    std::map<std::string_view, const transport::Stop*> stops;
+    for (const transport::Stop* stop : tc.FindStopsInBox(bounds.min, bounds.max)) {
+        stops.emplace(stop->stop_name, stop);
+    }
+    stops_ = &stops;
+    // выводятся только маршруты с видимыми отрезками или концевыми остановками внутри плитки,
+    // номер маршрута задаёт и порядок имён, и цвет
+    std::map<uint32_t, DrawnRoute> visible_routes;
+    const auto add_route = [this, &tc, &visible_routes](uint32_t bus_id) -> DrawnRoute& {
+        const uint32_t order = tc.GetRouteOrder(bus_id);
+        const auto [it, inserted] = visible_routes.try_emplace(order);
+        if (inserted) {
+            it->second.route = &tc.GetBusById(bus_id);
+            it->second.color_index = GetColorIndex(order);
+        }
+        return it->second;
+    };
+    for (const transport::RouteSegment& segment : tc.FindRouteSegmentsInBox(bounds.min, bounds.max)) {
+        add_route(segment.bus_id).visible_positions.push_back(segment.position);
+    }
+    for (const auto& [name, stop] : stops) {
+        for (const uint32_t bus_id : tc.GetBusesForStop(name)) {
+            const transport::BusRoute& route = tc.GetBusById(bus_id);
+            if (route.route_stops.front() == stop || route.route_stops.back() == stop) {
+                add_route(bus_id);
+            }
+        }
+    }
+    std::vector<DrawnRoute> routes;
+    routes.reserve(visible_routes.size());
+    for (auto& [order, route] : visible_routes) {
+        routes.push_back(std::move(route));
+    }
+    routes_ = &routes;
+    tile_ = &bounds;
+    const std::vector<geo::Coordinates> corners{bounds.min, bounds.max};
+    SphereProjector projector(corners.begin(), corners.end(), settings_.width, settings_.height, settings_.padding);
+    projector_ = &projector;
+    RenderLayers(tc, svg_doc);
+}
+
+void MapRenderer::RenderSvgTile(const transport::TransportCatalogue& tc, const TileBounds& bounds, std::ostream& out) {
+    svg::PackedDocument svg_doc;
+    RenderSvgTile(tc, bounds, svg_doc);
+    svg_doc.Render(out);
+}
+
+void MapRenderer::RenderLayers(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc) {
     RenderLines(svg_doc);
     RenderRouteNames(svg_doc);
     RenderStopCircles(tc, svg_doc);
@@ -29,88 +166,153 @@ void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, svg::Doc
     stops_ = nullptr;
     routes_ = nullptr;
     projector_ = nullptr;
+    tile_ = nullptr;
 }
 
-void MapRenderer::RenderSvgMap(const transport::TransportCatalogue &tc, std::ostream& out) {
-    svg::Document svg_doc;
-    RenderSvgMap(tc, svg_doc);
-    svg_doc.Render(out);
+bool MapRenderer::IsVisible(geo::Coordinates coordinates) const {
+    return tile_ == nullptr
+           || (coordinates.latitude >= tile_->min.latitude && coordinates.latitude <= tile_->max.latitude
+               && coordinates.longitude >= tile_->min.longitude && coordinates.longitude <= tile_->max.longitude);
+}
+
+size_t MapRenderer::GetColorIndex(uint32_t route_order) const {
+    if (settings_.color_palette.empty()) { return 0; }
+    return route_order % settings_.color_palette.size();
 }
 
-svg::Color MapRenderer::GetNextColor(size_t &color_count) const {
-    if (color_count >= settings_.color_palette.size()) { color_count = 0; }
-    return settings_.color_palette[color_count++];
+std::vector<svg::StyleId> MapRenderer::AddPaletteStyles(svg::PackedDocument& svg_doc, const svg::Style& style, bool stroke) const {
+    std::vector<svg::StyleId> result;
+    result.reserve(settings_.color_palette.size());
+    for (const svg::Color& color : settings_.color_palette) {
+        svg::Style palette_style = style;
+        (stroke ? palette_style.stroke_color : palette_style.fill_color) = color;
+        result.push_back(svg_doc.AddStyle(std::move(palette_style)));
+    }
+    return result;
+}
+
+svg::Style MapRenderer::MakeUnderlayerStyle() const {
+    svg::Style style;
+    style.fill_color = settings_.underlayer_color;
+    style.stroke_color = settings_.underlayer_color;
+    style.stroke_width = settings_.underlayer_width;
+    style.stroke_linecap = svg::StrokeLineCap::ROUND;
+    style.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+    return style;
 }
 
-void MapRenderer::RenderLines(svg::Document &svg_doc) const {
-    size_t color_count = 0;
+void MapRenderer::RenderLines(svg::PackedDocument &svg_doc) const {
     auto projector = *projector_;
-    for (const auto route : *routes_) {
-        if (route.second->route_stops.empty()) { continue; }
-        svg::Color palette_color = GetNextColor(color_count);
-        svg::Polyline line;
-        line.SetStrokeColor(palette_color).SetFillColor({}).SetStrokeWidth(settings_.line_width)
-                .SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-        for (auto route_stop : route.second->route_stops) {
-            line.AddPoint(projector( route_stop->coordinates ));
+    svg::Style line_style;
+    line_style.fill_color = svg::NoneColor;
+    line_style.stroke_width = settings_.line_width;
+    line_style.stroke_linecap = svg::StrokeLineCap::ROUND;
+    line_style.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+    const std::vector<svg::StyleId> line_styles = AddPaletteStyles(svg_doc, line_style, true);
+    std::vector<svg::Point> points;
+    for (const DrawnRoute& drawn : *routes_) {
+        const transport::BusRoute& route = *drawn.route;
+        const svg::StyleId line = line_styles.at(drawn.color_index);
+        if (tile_ != nullptr) {
+            // идущие подряд видимые отрезки рисуются одной ломаной
+            const std::vector<uint32_t>& positions = drawn.visible_positions;
+            for (size_t begin = 0, end = 0; begin < positions.size(); begin = end) {
+                end = begin + 1;
+                while (end < positions.size() && positions[end] == positions[end - 1] + 1) { ++end; }
+                points.clear();
+                for (uint32_t position = positions[begin]; position <= positions[end - 1] + 1; ++position) {
+                    points.push_back(projector(route.route_stops[position]->coordinates));
+                }
+                AddLine(svg_doc, line, points);
+            }
+            continue;
         }
-        if (route.second->type == transport::RouteType::RETURN_ROUTE) {
-            for (auto back_iter = std::next(route.second->route_stops.rbegin()); back_iter != route.second->route_stops.rend(); ++back_iter) {
-                line.AddPoint(projector( (*back_iter)->coordinates ));
+        points.clear();
+        for (auto route_stop : route.route_stops) {
+            points.push_back(projector( route_stop->coordinates ));
+        }
+        // при упрощении обратный путь не выводится: он проходит по тем же точкам
+        if (route.type == transport::RouteType::RETURN_ROUTE && settings_.line_simplification_tolerance <= 0) {
+            for (auto back_iter = std::next(route.route_stops.rbegin()); back_iter != route.route_stops.rend(); ++back_iter) {
+                points.push_back(projector( (*back_iter)->coordinates ));
             }
         }
-        svg_doc.Add(std::move(line));
+        AddLine(svg_doc, line, points);
+    }
+}
+
+void MapRenderer::AddLine(svg::PackedDocument& svg_doc, svg::StyleId style, const std::vector<svg::Point>& points) const {
+    svg_doc.StartPolyline(style);
+    if (settings_.line_simplification_tolerance <= 0) {
+        for (const svg::Point& point : points) {
+            svg_doc.AddPolylinePoint(point);
+        }
+        return;
+    }
+    for (const svg::Point& point : SimplifyPolyline(points, settings_.line_simplification_tolerance)) {
+        svg_doc.AddPolylinePoint(point);
     }
 }
 
-void MapRenderer::RenderRouteNames(svg::Document& svg_doc) const {
+void MapRenderer::RenderRouteNames(svg::PackedDocument& svg_doc) const {
     auto projector = *projector_;
-    size_t color_count = 0;
-    for (auto route : *routes_) {
-        if (route.second->route_stops.empty()) { continue; }
-        svg::Text name_start_text;
-        name_start_text.SetData(std::string{route.first}).SetPosition( projector(route.second->route_stops.front()->coordinates) )
-                .SetOffset(settings_.bus_label_offset).SetFontSize(settings_.bus_label_font_size)
-                .SetFontFamily("Verdana"s).SetFontWeight("bold"s).SetFillColor(GetNextColor(color_count));
-
-        svg::Text name_start_plate = name_start_text;
-        name_start_plate.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color)
-                .SetStrokeWidth(settings_.underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-        svg_doc.Add(name_start_plate);
-        svg_doc.Add(name_start_text);
-        if (route.second->type == transport::RouteType::CIRCLE_ROUTE) { continue; }
-        if (route.second->route_stops.front()->stop_name == route.second->route_stops.back()->stop_name) { continue; }
-        name_start_text.SetPosition(projector(route.second->route_stops.back()->coordinates));
-        name_start_plate.SetPosition(projector(route.second->route_stops.back()->coordinates));
-        svg_doc.Add(name_start_plate);
-        svg_doc.Add(name_start_text);
-    }
-}
-
-void MapRenderer::RenderStopCircles(const transport::TransportCatalogue& tc, svg::Document& svg_doc) const {
+    svg::Style text_style;
+    text_style.text_offset = settings_.bus_label_offset;
+    text_style.font_size = static_cast<uint32_t>(settings_.bus_label_font_size);
+    text_style.font_family = "Verdana"s;
+    text_style.font_weight = "bold"s;
+    const std::vector<svg::StyleId> text_styles = AddPaletteStyles(svg_doc, text_style, false);
+    svg::Style plate_style = MakeUnderlayerStyle();
+    plate_style.text_offset = text_style.text_offset;
+    plate_style.font_size = text_style.font_size;
+    plate_style.font_family = text_style.font_family;
+    plate_style.font_weight = text_style.font_weight;
+    const svg::StyleId plate = svg_doc.AddStyle(std::move(plate_style));
+    for (const DrawnRoute& drawn : *routes_) {
+        const transport::BusRoute& route = *drawn.route;
+        const svg::StyleId text = text_styles.at(drawn.color_index);
+        if (IsVisible(route.route_stops.front()->coordinates)) {
+            const svg::Point start = projector(route.route_stops.front()->coordinates);
+            svg_doc.AddText(start, route.bus_name, plate);
+            svg_doc.AddText(start, route.bus_name, text);
+        }
+        if (route.type == transport::RouteType::CIRCLE_ROUTE) { continue; }
+        if (route.route_stops.front()->stop_name == route.route_stops.back()->stop_name) { continue; }
+        if (!IsVisible(route.route_stops.back()->coordinates)) { continue; }
+        const svg::Point end = projector(route.route_stops.back()->coordinates);
+        svg_doc.AddText(end, route.bus_name, plate);
+        svg_doc.AddText(end, route.bus_name, text);
+    }
+}
+
+void MapRenderer::RenderStopCircles(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc) const {
     auto projector = *projector_;
+    svg::Style circle_style;
+    circle_style.fill_color = "white"s;
+    const svg::StyleId circle = svg_doc.AddStyle(std::move(circle_style));
     for (const auto& stop : *stops_) {
         if ( tc.GetBusesForStop(stop.first).empty() ) { continue; }
-        svg::Circle stop_circle;
-        stop_circle.SetCenter( projector(stop.second->coordinates) ).SetRadius(settings_.stop_radius).SetFillColor("white"s);
-        svg_doc.Add(stop_circle);
+        svg_doc.AddCircle(projector(stop.second->coordinates), settings_.stop_radius, circle);
     }
 }
 
-void MapRenderer::RenderStopNames(const transport::TransportCatalogue& tc, svg::Document& svg_doc) const {
+void MapRenderer::RenderStopNames(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc) const {
     auto projector = *projector_;
+    svg::Style name_style;
+    name_style.fill_color = "black"s;
+    name_style.text_offset = settings_.stop_label_offset;
+    name_style.font_size = static_cast<uint32_t>(settings_.stop_label_font_size);
+    name_style.font_family = "Verdana"s;
+    svg::Style plate_style = MakeUnderlayerStyle();
+    plate_style.text_offset = name_style.text_offset;
+    plate_style.font_size = name_style.font_size;
+    plate_style.font_family = name_style.font_family;
+    const svg::StyleId plate = svg_doc.AddStyle(std::move(plate_style));
+    const svg::StyleId name = svg_doc.AddStyle(std::move(name_style));
     for (const auto& stop : *stops_) {
         if (tc.GetBusesForStop(stop.first).empty()) { continue; }
-        svg::Text stop_name;
-        stop_name.SetPosition(projector(stop.second->coordinates)).SetOffset(settings_.stop_label_offset)
-                .SetFontSize(settings_.stop_label_font_size).SetFontFamily("Verdana"s).SetData(std::string{stop.first});
-        svg::Text stop_plate = stop_name;
-        stop_plate.SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color).SetStrokeWidth(settings_.underlayer_width)
-                .SetStrokeLineCap(svg::StrokeLineCap::ROUND).SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-        stop_name.SetFillColor("black"s);
-        svg_doc.Add(stop_plate);
-        svg_doc.Add(stop_name);
-    }
-}
\ No newline at end of file
+        const svg::Point position = projector(stop.second->coordinates);
+        svg_doc.AddText(position, stop.first, plate);
+        svg_doc.AddText(position, stop.first, name);
+    }
+}
@@ -78,21 +78,57 @@ struct RendererSettings {
     svg::Color underlayer_color;
     double underlayer_width;
     std::vector<svg::Color> color_palette;
+    // допуск упрощения линий маршрутов в пикселях изображения, 0 - линии выводятся через все остановки
+    double line_simplification_tolerance = 0;
 };
 
+// Прямоугольник координат, который выводится плиткой карты
+struct TileBounds {
+    geo::Coordinates min;
+    geo::Coordinates max;
+};
+
+inline const uint32_t MAX_TILE_ZOOM = 30;
+// Границы плитки zoom/x/y в схеме веб-карт: 2^zoom плиток по каждой оси в проекции Меркатора, y растёт к югу
+TileBounds GetTileBounds(uint32_t zoom, uint32_t x, uint32_t y);
+
 class MapRenderer{
 public:
     explicit MapRenderer(const RendererSettings& settings) : settings_(settings) {}
     void RenderSvgMap(const transport::TransportCatalogue& tc, std::ostream& out);
-    void RenderSvgMap(const transport::TransportCatalogue &tc, svg::Document& svg_doc);
+    void RenderSvgMap(const transport::TransportCatalogue &tc, svg::PackedDocument& svg_doc);
+    // Часть карты внутри прямоугольника: проекция подгоняется под прямоугольник, по пространственным индексам
+    // выбираются только видимые отрезки линий, подписи и остановки. Цвета автобусов совпадают с полной картой,
+    // линия маршрута туда-обратно рисуется один раз
+    void RenderSvgTile(const transport::TransportCatalogue& tc, const TileBounds& bounds, std::ostream& out);
+    void RenderSvgTile(const transport::TransportCatalogue& tc, const TileBounds& bounds, svg::PackedDocument& svg_doc);
 private:
+    // маршрут, который выводится на карту, с цветом палитры
+    struct DrawnRoute {
+        const transport::BusRoute* route;
+        size_t color_index;
+        // при отрисовке плитки: позиции видимых отрезков в route_stops по возрастанию
+        std::vector<uint32_t> visible_positions;
+    };
     SphereProjector* projector_ = nullptr;
-    svg::Color GetNextColor(size_t &color_count) const;
+    // при отрисовке плитки: её границы
+    const TileBounds* tile_ = nullptr;
+    bool IsVisible(geo::Coordinates coordinates) const;
+    // рисует слои карты по заполненным routes_, stops_ и projector_, затем сбрасывает указатели
+    void RenderLayers(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc);
+    // цвет палитры маршрута по его номеру среди маршрутов с остановками, по кругу
+    size_t GetColorIndex(uint32_t route_order) const;
+    // оформление элемента для каждого цвета палитры; элементы карты ссылаются на общие стили документа
+    std::vector<svg::StyleId> AddPaletteStyles(svg::PackedDocument& svg_doc, const svg::Style& style, bool stroke) const;
+    svg::Style MakeUnderlayerStyle() const;
     const RendererSettings& settings_;
-    const std::map<std::string_view, const transport::BusRoute*>* routes_ = nullptr;
+    // маршруты в порядке имён
+    const std::vector<DrawnRoute>* routes_ = nullptr;
     const std::map<std::string_view, const transport::Stop*>* stops_ = nullptr;
-    void RenderLines(svg::Document& svg_doc) const;
-    void RenderRouteNames(svg::Document& svg_doc) const;
-    void RenderStopCircles(const transport::TransportCatalogue& tc, svg::Document& svg_doc) const;
-    void RenderStopNames(const transport::TransportCatalogue& tc, svg::Document& svg_doc) const;
+    void RenderLines(svg::PackedDocument& svg_doc) const;
+    // ломаная маршрута, упрощённая с допуском line_simplification_tolerance
+    void AddLine(svg::PackedDocument& svg_doc, svg::StyleId style, const std::vector<svg::Point>& points) const;
+    void RenderRouteNames(svg::PackedDocument& svg_doc) const;
+    void RenderStopCircles(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc) const;
+    void RenderStopNames(const transport::TransportCatalogue& tc, svg::PackedDocument& svg_doc) const;
 };
\ No newline at end of file
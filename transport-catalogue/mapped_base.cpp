@@ -0,0 +1,81 @@
+#include "mapped_base.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+
+namespace mapped_base {
+
+    Writer::Writer() : buffer_(sizeof(Header), '\0') {
+    }
+
+    NameRef Writer::AddName(std::string_view name) {
+        auto it = name_refs_.find(std::string{name});
+        if (it != name_refs_.end()) {
+            return it->second;
+        }
+        NameRef result{static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(name.size())};
+        names_.append(name);
+        name_refs_.emplace(std::string{name}, result);
+        return result;
+    }
+
+    void Writer::Save(const std::string& file_name, Header header) {
+        header.names = Append(names_.data(), names_.size());
+        std::memcpy(buffer_.data(), &header, sizeof(Header));
+        std::ofstream out(file_name, std::ios::binary | std::ios::out);
+        out.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        if (!out) {
+            throw std::runtime_error("Can't write router file: " + file_name);
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& file_name) {
+        const int fd = open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Can't open router file: " + file_name);
+        }
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("Corrupted router file: " + file_name);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Can't map router file: " + file_name);
+        }
+        data_ = static_cast<const char*>(data);
+        const Header& header = GetHeader();
+        if (header.magic != MAGIC || header.version != VERSION) {
+            munmap(const_cast<char*>(data_), size_);
+            throw std::runtime_error("Unsupported router file format: " + file_name);
+        }
+        // секция имён проверяется один раз, дальше GetName сравнивает ссылки только с её размером
+        try {
+            names_ = GetSection<char>(header.names, header.names.count);
+        } catch (...) {
+            munmap(const_cast<char*>(data_), size_);
+            throw;
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        munmap(const_cast<char*>(data_), size_);
+    }
+
+    const Header& MappedFile::GetHeader() const {
+        return *reinterpret_cast<const Header*>(data_);
+    }
+
+    std::string_view MappedFile::GetName(NameRef name) const {
+        const Section& names = GetHeader().names;
+        if (name.offset + static_cast<uint64_t>(name.size) > names.count) {
+            throw std::runtime_error("Corrupted router file: bad name reference");
+        }
+        return {names_ + name.offset, name.size};
+    }
+} // namespace mapped_base
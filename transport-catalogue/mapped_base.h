@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+/*
+ * Плоский формат файла с данными маршрутизатора: заголовок и выровненные на 8 байт секции,
+ * на которые заголовок ссылается смещениями от начала файла. При загрузке файл отображается
+ * в память (mmap) и читается на месте: граф, вершины, связи и матрица маршрутов не разбираются
+ * и не копируются, а страницы подгружаются по мере обращения к ним.
+ */
+namespace mapped_base {
+
+    constexpr uint32_t MAGIC = 0x46524354; // "TCRF"
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t NO_ID = UINT32_MAX;
+
+    struct Section {
+        uint64_t offset = 0;
+        uint64_t count = 0;
+    };
+
+    struct Header {
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        uint64_t vertex_count = 0;
+        Section offsets;       // EdgeId[vertex_count + 1], смещения CSR
+        Section edges;         // graph::Edge<double>[], рёбра в порядке CSR
+        Section vertices;      // VertexRecord[vertex_count]
+        Section links;         // LinkRecord[] по идентификатору ребра, пусто для модели ride_vertices
+        Section stop_vertices; // VertexId по идентификатору остановки
+        Section routes;        // Router::RouteCell[vertex_count * vertex_count], только для all_pairs
+        Section names;         // char[], названия автобусов
+    };
+
+    struct NameRef {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    struct VertexRecord {
+        uint32_t stop_id;
+        uint32_t stop_number;
+        NameRef bus_name;
+    };
+
+    struct LinkRecord {
+        NameRef bus_name;
+        uint32_t stop_from;
+        uint32_t stop_to;
+        uint32_t number_of_stops;
+    };
+
+    class Writer {
+    public:
+        Writer();
+
+        template <typename T>
+        Section Append(const T* data, size_t count) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            buffer_.resize((buffer_.size() + 7) & ~size_t{7}, '\0');
+            Section section{buffer_.size(), count};
+            buffer_.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+            return section;
+        }
+        NameRef AddName(std::string_view name);
+        void Save(const std::string& file_name, Header header);
+
+    private:
+        std::string buffer_;
+        std::string names_;
+        std::unordered_map<std::string, NameRef> name_refs_;
+    };
+
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& file_name);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const Header& GetHeader() const;
+        std::string_view GetName(NameRef name) const;
+
+        template <typename T>
+        const T* GetSection(const Section& section, uint64_t expected_count) const {
+            static_assert(std::is_trivially_copyable_v<T>);
+            // размер секции сравнивается делением, чтобы повреждённые offset и count не переполнили сумму
+            if (section.count != expected_count || section.offset % alignof(T) != 0 || section.offset > size_
+                || section.count > (size_ - section.offset) / sizeof(T)) {
+                throw std::runtime_error("Corrupted router file: bad section");
+            }
+            return reinterpret_cast<const T*>(data_ + section.offset);
+        }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        const char* names_ = nullptr;
+    };
+} // namespace mapped_base
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -22,6 +23,9 @@ namespace ranges {
         It end() const {
             return end_;
         }
+        bool empty() const {
+            return begin_ == end_;
+        }
 
     private:
         It begin_;
@@ -33,4 +37,40 @@ namespace ranges {
         return Range{container.begin(), container.end()};
     }
 
+    // Итератор по последовательным целым числам, позволяет отдавать отрезок идентификаторов как Range
+    template <typename Id>
+    class CountingIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Id;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Id*;
+        using reference = Id;
+
+        explicit CountingIterator(Id value)
+                : value_(value) {
+        }
+        Id operator*() const {
+            return value_;
+        }
+        CountingIterator& operator++() {
+            ++value_;
+            return *this;
+        }
+        bool operator==(const CountingIterator& other) const {
+            return value_ == other.value_;
+        }
+        bool operator!=(const CountingIterator& other) const {
+            return value_ != other.value_;
+        }
+
+    private:
+        Id value_;
+    };
+
+    template <typename Id>
+    auto AsCountingRange(Id begin, Id end) {
+        return Range{CountingIterator<Id>{begin}, CountingIterator<Id>{end}};
+    }
+
 }  // namespace ranges
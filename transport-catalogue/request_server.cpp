@@ -0,0 +1,105 @@
+#include "request_server.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+
+namespace request_server {
+
+    namespace {
+        // Буфер потока поверх файлового дескриптора сокета
+        class SocketStreamBuf : public std::streambuf {
+        public:
+            explicit SocketStreamBuf(int fd) : fd_(fd) {
+                setg(input_, input_, input_);
+                setp(output_, output_ + sizeof(output_));
+            }
+
+        protected:
+            int_type underflow() override {
+                ssize_t count;
+                do {
+                    count = read(fd_, input_, sizeof(input_));
+                } while (count < 0 && errno == EINTR);
+                if (count <= 0) {
+                    return traits_type::eof();
+                }
+                setg(input_, input_, input_ + count);
+                return traits_type::to_int_type(input_[0]);
+            }
+
+            int_type overflow(int_type ch) override {
+                if (!Flush()) {
+                    return traits_type::eof();
+                }
+                if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                    *pptr() = traits_type::to_char_type(ch);
+                    pbump(1);
+                }
+                return traits_type::not_eof(ch);
+            }
+
+            int sync() override {
+                return Flush() ? 0 : -1;
+            }
+
+        private:
+            bool Flush() {
+                const char* data = pbase();
+                while (data < pptr()) {
+                    const ssize_t count = send(fd_, data, pptr() - data, MSG_NOSIGNAL);
+                    if (count < 0) {
+                        if (errno == EINTR) { continue; }
+                        return false;
+                    }
+                    data += count;
+                }
+                setp(output_, output_ + sizeof(output_));
+                return true;
+            }
+
+            int fd_;
+            char input_[4096];
+            char output_[4096];
+        };
+    } // namespace
+
+    void ServeUnixSocket(json_reader::JsonReader& reader, const std::string& socket_path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + socket_path);
+        }
+        std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server_fd < 0) {
+            throw std::runtime_error("Can't create socket");
+        }
+        unlink(socket_path.c_str());
+        if (bind(server_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(server_fd, 16) != 0) {
+            close(server_fd);
+            throw std::runtime_error("Can't listen on socket: " + socket_path);
+        }
+        while (true) {
+            const int client_fd = accept(server_fd, nullptr, nullptr);
+            if (client_fd < 0) {
+                if (errno == EINTR) { continue; }
+                break;
+            }
+            SocketStreamBuf buffer(client_fd);
+            std::istream input(&buffer);
+            std::ostream output(&buffer);
+            reader.ServeRequests(input, output);
+            output.flush();
+            close(client_fd);
+        }
+        close(server_fd);
+        unlink(socket_path.c_str());
+    }
+
+} // namespace request_server
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include "json_reader.h"
+
+/*
+ * Долгоживущий режим обработки запросов: база загружается один раз, затем пакеты запросов
+ * принимаются построчно (NDJSON) через локальный Unix-сокет. Клиенты обслуживаются по очереди,
+ * каждое соединение - поток строк-пакетов до закрытия соединения клиентом.
+ */
+namespace request_server {
+
+    void ServeUnixSocket(json_reader::JsonReader& reader, const std::string& socket_path);
+
+} // namespace request_server
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "graph.h"
+#include "contraction_hierarchy.h"
+#include "serialization.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <memory>
 #include <optional>
+#include <queue>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -15,16 +20,47 @@
 
 namespace graph {
 
+    /*
+     * ALL_PAIRS - матрица кратчайших путей между всеми парами вершин строится заранее (Флойд-Уоршелл), O(V^3) и O(V^2) памяти
+     * BIDIRECTIONAL_DIJKSTRA - маршрут ищется двунаправленным алгоритмом Дейкстры на каждый запрос, O(E) памяти
+     * CONTRACTION_HIERARCHIES - иерархия сжатия строится заранее, запрос - двунаправленный поиск вверх по иерархии
+     */
+    enum class RouterType {
+        ALL_PAIRS,
+        BIDIRECTIONAL_DIJKSTRA,
+        CONTRACTION_HIERARCHIES,
+    };
+
+    // Состояние ячейки матрицы маршрутов в файле, отображаемом в память
+    enum class RouteCellState : uint32_t {
+        NO_ROUTE = 0,
+        NO_PREV_EDGE = 1, // маршрут из вершины в саму себя
+        HAS_PREV_EDGE = 2,
+    };
+
     template <typename Weight>
     class Router {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
     public:
-        explicit Router(const Graph& graph);
-        explicit Router(const Graph& graph, const tc_serialize::TransportCatalogue& tc_);
+        explicit Router(const Graph& graph, RouterType type = RouterType::ALL_PAIRS);
+        // restored_edge_ids - новые номера рёбер графа, если он перенумеровал их при загрузке (restored_edge_ids[старый] = новый):
+        // базы старого формата хранят рёбра не в порядке CSR
+        explicit Router(const Graph& graph, const tc_serialize::TransportCatalogue& tc_,
+                        const std::vector<EdgeId>& restored_edge_ids = {});
+
+        // Ячейка матрицы маршрутов в плоском виде для файла, отображаемого в память, prev_edge задан только при HAS_PREV_EDGE
+        struct RouteCell {
+            Weight weight;
+            EdgeId prev_edge;
+            RouteCellState state;
+        };
+        // Матрица all_pairs читается на месте из mapped_routes (vertex_count * vertex_count ячеек по строкам)
+        Router(const Graph& graph, const tc_serialize::TransportCatalogue& tc_, const RouteCell* mapped_routes);
 
-        bool SaveTo(tc_serialize::TransportCatalogue& tc_to) const;
-        bool RestoreFrom(const tc_serialize::TransportCatalogue& tc_from);
+        bool SaveTo(tc_serialize::TransportCatalogue& tc_to, bool with_routes_matrix = true) const;
+        bool RestoreFrom(const tc_serialize::TransportCatalogue& tc_from, const std::vector<EdgeId>& restored_edge_ids = {});
+        std::vector<RouteCell> ExportRouteCells() const;
 
         struct RouteInfo {
             Weight weight;
@@ -33,6 +69,19 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // Маршрут от любой из точек from до любой из to: вес включает веса выбранных точек,
+        // from_index и to_index - их номера во входных массивах
+        struct EndpointsRouteInfo {
+            RouteInfo route;
+            size_t from_index;
+            size_t to_index;
+        };
+        std::optional<EndpointsRouteInfo> BuildRoute(const std::vector<RouteEndpoint<Weight>>& from,
+                                                     const std::vector<RouteEndpoint<Weight>>& to) const;
+        // Веса кратчайших путей from[i] -> to[j] по строкам (пусто - пути нет), рёбра маршрутов не восстанавливаются
+        std::vector<std::optional<Weight>> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+        RouterType GetType() const;
+
         struct RouteInternalData {
             Weight weight;
             std::optional<EdgeId> prev_edge;
@@ -40,8 +89,24 @@ namespace graph {
         using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
     private:
-        tc_serialize::RouteIntDataPB SerializeRouteIntData(const std::optional<Router<Weight>::RouteInternalData> &data) const;
+        std::optional<RouteInfo> BuildRouteAllPairs(VertexId from, VertexId to) const;
+        std::optional<RouteInternalData> GetRouteInternalData(VertexId from, VertexId to) const;
+        std::optional<RouteInfo> BuildRouteBidirectional(const std::vector<RouteEndpoint<Weight>>& from,
+                                                         const std::vector<RouteEndpoint<Weight>>& to) const;
+        void BuildWeightRow(VertexId from, const std::vector<VertexId>& to, std::vector<std::optional<Weight>>& weights,
+                            std::optional<Weight>* row) const;
+        std::optional<EndpointsRouteInfo> ResolveEndpoints(std::optional<RouteInfo> route,
+                                                           const std::vector<RouteEndpoint<Weight>>& from,
+                                                           const std::vector<RouteEndpoint<Weight>>& to) const;
+        void InitializeReverseIncidenceLists(const Graph& graph);
+        void InitializeAllPairs(const Graph& graph);
         std::optional<RouteInternalData> DeserializeRouteIntData(const tc_serialize::RouteIntDataPB& data) const;
+        tc_serialize::PackedRoutesPB SerializePackedRoutes() const;
+        void DeserializePackedRoutes(const tc_serialize::PackedRoutesPB& data);
+        void DeserializeLegacyRoutes(const tc_serialize::RoutesInternalDataListsPB& data);
+        void RestoreRouteEdgeIds(const std::vector<EdgeId>& restored_edge_ids);
+        static uint64_t ZigZagEncode(int64_t value);
+        static int64_t ZigZagDecode(uint64_t value);
 
         void InitializeRoutesInternalData(const Graph& graph) {
             const size_t vertex_count = graph.GetVertexCount();
@@ -83,7 +148,14 @@ namespace graph {
         }
         static constexpr Weight ZERO_WEIGHT{};
         const Graph& graph_;
+        RouterType type_ = RouterType::ALL_PAIRS;
         RoutesInternalData routes_internal_data_;
+        const RouteCell* mapped_routes_ = nullptr;
+        std::unique_ptr<ContractionHierarchy<Weight>> contraction_hierarchy_;
+        // входящие рёбра для каждой вершины в формате CSR, нужны для обратного поиска Дейкстры:
+        // reverse_edges_[reverse_offsets_[v]..reverse_offsets_[v + 1]) - рёбра, входящие в v
+        std::vector<EdgeId> reverse_offsets_;
+        std::vector<EdgeId> reverse_edges_;
     };
 
     template<typename Weight>
@@ -101,84 +173,515 @@ namespace graph {
     }
 
     template<typename Weight>
-    tc_serialize::RouteIntDataPB
-    Router<Weight>::SerializeRouteIntData(const std::optional<Router<Weight>::RouteInternalData> &data) const {
-        tc_serialize::RouteIntDataPB result;
-        if (!data) {
-            result.set_data_empty(true);
-            return result;
-        }
-        result.set_data_empty(false);
-        if (data->prev_edge) {
-            result.set_prev_edge_empty(false);
-            result.set_prev_edge(data->prev_edge.value());
-        } else {
-            result.set_prev_edge_empty(true);
+    uint64_t Router<Weight>::ZigZagEncode(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    template<typename Weight>
+    int64_t Router<Weight>::ZigZagDecode(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    template<typename Weight>
+    tc_serialize::PackedRoutesPB Router<Weight>::SerializePackedRoutes() const {
+        tc_serialize::PackedRoutesPB result;
+        const size_t vertex_count = routes_internal_data_.size();
+        result.set_vertex_count(vertex_count);
+        result.mutable_cells()->Reserve(static_cast<int>(vertex_count * vertex_count));
+        int64_t last_prev_edge = 0;
+        for (const auto& vertex_list : routes_internal_data_) {
+            for (const auto& data : vertex_list) {
+                if (!data) {
+                    result.add_cells(0);
+                    continue;
+                }
+                if (data->prev_edge) {
+                    const auto prev_edge = static_cast<int64_t>(*data->prev_edge);
+                    result.add_cells(2 + ZigZagEncode(prev_edge - last_prev_edge));
+                    last_prev_edge = prev_edge;
+                } else {
+                    result.add_cells(1);
+                }
+                result.add_weights(data->weight);
+            }
         }
-        result.set_weight(data->weight);
         return result;
     }
 
     template<typename Weight>
-    bool Router<Weight>::RestoreFrom(const tc_serialize::TransportCatalogue &tc_from) {
-        const auto& data_from = tc_from.router_settings().router_routes_int_data();
-        routes_internal_data_.reserve(data_from.routes_list_size());
-        for (int i = 0; i < data_from.routes_list_size(); ++i) {
-            const tc_serialize::VertexCountListPB& small_list = data_from.routes_list(i);
+    void Router<Weight>::DeserializePackedRoutes(const tc_serialize::PackedRoutesPB& data) {
+        const size_t vertex_count = data.vertex_count();
+        if (static_cast<size_t>(data.cells_size()) != vertex_count * vertex_count) {
+            throw std::logic_error("Corrupted router data: wrong number of cells");
+        }
+        routes_internal_data_.assign(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+        int64_t last_prev_edge = 0;
+        int weight_index = 0;
+        auto cell = data.cells().begin();
+        for (auto& vertex_list : routes_internal_data_) {
+            for (auto& route : vertex_list) {
+                const uint64_t code = *cell++;
+                if (code == 0) {
+                    continue;
+                }
+                if (weight_index == data.weights_size()) {
+                    throw std::logic_error("Corrupted router data: not enough weights");
+                }
+                route = RouteInternalData{data.weights(weight_index++), std::nullopt};
+                if (code > 1) {
+                    last_prev_edge += ZigZagDecode(code - 2);
+                    route->prev_edge = static_cast<EdgeId>(last_prev_edge);
+                }
+            }
+        }
+    }
+
+    template<typename Weight>
+    void Router<Weight>::DeserializeLegacyRoutes(const tc_serialize::RoutesInternalDataListsPB& data) {
+        routes_internal_data_.reserve(data.routes_list_size());
+        for (int i = 0; i < data.routes_list_size(); ++i) {
+            const tc_serialize::VertexCountListPB& small_list = data.routes_list(i);
             std::vector<std::optional<RouteInternalData>> out_list(small_list.vertex_list_size());
             for (int j = 0; j < small_list.vertex_list_size(); ++j) {
-                const tc_serialize::RouteIntDataPB& data = small_list.vertex_list(j);
-                out_list[j] = DeserializeRouteIntData(data);
+                out_list[j] = DeserializeRouteIntData(small_list.vertex_list(j));
             }
             routes_internal_data_.emplace_back(std::move(out_list));
-        } return true;
+        }
     }
 
     template<typename Weight>
-    bool Router<Weight>::SaveTo(tc_serialize::TransportCatalogue &tc_to) const {
-        tc_serialize::RoutesInternalDataListsPB big_list;
-        for (const auto& vertex_list : routes_internal_data_) {
-            tc_serialize::VertexCountListPB int_data_list;
-            for (const auto& data : vertex_list) {
-                *int_data_list.add_vertex_list() = SerializeRouteIntData(data);
+    bool Router<Weight>::RestoreFrom(const tc_serialize::TransportCatalogue &tc_from, const std::vector<EdgeId>& restored_edge_ids) {
+        const RouterType router_type = DeserializeRouterType(tc_from.router_settings().routing_settings().router_type());
+        if (router_type == RouterType::BIDIRECTIONAL_DIJKSTRA) {
+            type_ = RouterType::BIDIRECTIONAL_DIJKSTRA;
+            InitializeReverseIncidenceLists(graph_);
+            return true;
+        }
+        if (router_type == RouterType::CONTRACTION_HIERARCHIES) {
+            type_ = RouterType::CONTRACTION_HIERARCHIES;
+            contraction_hierarchy_ = std::make_unique<ContractionHierarchy<Weight>>(graph_, tc_from, restored_edge_ids);
+            return true;
+        }
+        type_ = RouterType::ALL_PAIRS;
+        if (mapped_routes_) {
+            return true;
+        }
+        const auto& router_settings = tc_from.router_settings();
+        if (router_settings.has_router_routes_packed()) {
+            DeserializePackedRoutes(router_settings.router_routes_packed());
+        } else {
+            DeserializeLegacyRoutes(router_settings.router_routes_int_data());
+        }
+        RestoreRouteEdgeIds(restored_edge_ids);
+        return true;
+    }
+
+    template<typename Weight>
+    void Router<Weight>::RestoreRouteEdgeIds(const std::vector<EdgeId>& restored_edge_ids) {
+        if (restored_edge_ids.empty()) {
+            return;
+        }
+        for (auto& vertex_list : routes_internal_data_) {
+            for (auto& route : vertex_list) {
+                if (route && route->prev_edge) {
+                    if (*route->prev_edge >= restored_edge_ids.size()) {
+                        throw std::logic_error("Corrupted router data: edge id is out of range");
+                    }
+                    route->prev_edge = restored_edge_ids[*route->prev_edge];
+                }
             }
-            *big_list.add_routes_list() = std::move(int_data_list);
         }
-        *(tc_to.mutable_router_settings()->mutable_router_routes_int_data()) = std::move(big_list);
+    }
+
+    template<typename Weight>
+    bool Router<Weight>::SaveTo(tc_serialize::TransportCatalogue &tc_to, bool with_routes_matrix) const {
+        if (type_ == RouterType::ALL_PAIRS && with_routes_matrix) {
+            *(tc_to.mutable_router_settings()->mutable_router_routes_packed()) = SerializePackedRoutes();
+        }
+        if (contraction_hierarchy_) {
+            contraction_hierarchy_->SaveTo(tc_to);
+        }
         return true;
     }
 
     template<typename Weight>
-    Router<Weight>::Router(const Router::Graph &graph, const tc_serialize::TransportCatalogue &tc_pbuf)
+    Router<Weight>::Router(const Router::Graph &graph, const tc_serialize::TransportCatalogue &tc_pbuf,
+                           const std::vector<EdgeId>& restored_edge_ids)
             : graph_(graph) {
+        RestoreFrom(tc_pbuf, restored_edge_ids);
+    }
+
+    template<typename Weight>
+    Router<Weight>::Router(const Router::Graph &graph, const tc_serialize::TransportCatalogue &tc_pbuf,
+                           const RouteCell* mapped_routes)
+            : graph_(graph)
+            , mapped_routes_(mapped_routes) {
         RestoreFrom(tc_pbuf);
     }
 
+    template<typename Weight>
+    std::vector<typename Router<Weight>::RouteCell> Router<Weight>::ExportRouteCells() const {
+        std::vector<RouteCell> result;
+        result.reserve(routes_internal_data_.size() * routes_internal_data_.size());
+        for (const auto& vertex_list : routes_internal_data_) {
+            for (const auto& data : vertex_list) {
+                if (!data) {
+                    result.push_back({ZERO_WEIGHT, 0, RouteCellState::NO_ROUTE});
+                } else if (!data->prev_edge) {
+                    result.push_back({data->weight, 0, RouteCellState::NO_PREV_EDGE});
+                } else {
+                    result.push_back({data->weight, *data->prev_edge, RouteCellState::HAS_PREV_EDGE});
+                }
+            }
+        }
+        return result;
+    }
+
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, RouterType type)
             : graph_(graph)
-            , routes_internal_data_(graph.GetVertexCount(),std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+            , type_(type)
     {
-        InitializeRoutesInternalData(graph);
+        if (type_ == RouterType::BIDIRECTIONAL_DIJKSTRA) {
+            InitializeReverseIncidenceLists(graph);
+        } else if (type_ == RouterType::CONTRACTION_HIERARCHIES) {
+            contraction_hierarchy_ = std::make_unique<ContractionHierarchy<Weight>>(graph);
+        } else {
+            InitializeAllPairs(graph);
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::InitializeAllPairs(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
+        routes_internal_data_.assign(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+        InitializeRoutesInternalData(graph);
         for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
             RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
         }
     }
 
+    template <typename Weight>
+    void Router<Weight>::InitializeReverseIncidenceLists(const Graph& graph) {
+        const size_t vertex_count = graph.GetVertexCount();
+        reverse_offsets_.assign(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            ++reverse_offsets_[edge.to + 1];
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            reverse_offsets_[vertex + 1] += reverse_offsets_[vertex];
+        }
+        std::vector<EdgeId> next_position(reverse_offsets_.begin(), reverse_offsets_.end() - 1);
+        reverse_edges_.resize(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            reverse_edges_[next_position[graph.GetEdge(edge_id).to]++] = edge_id;
+        }
+    }
+
+    template <typename Weight>
+    RouterType Router<Weight>::GetType() const {
+        return type_;
+    }
+
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from, VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+        if (type_ == RouterType::BIDIRECTIONAL_DIJKSTRA) {
+            return BuildRouteBidirectional({{from, ZERO_WEIGHT}}, {{to, ZERO_WEIGHT}});
+        }
+        if (type_ == RouterType::CONTRACTION_HIERARCHIES) {
+            auto route = contraction_hierarchy_->BuildRoute(from, to);
+            if (!route) {
+                return std::nullopt;
+            }
+            return RouteInfo{route->weight, std::move(route->edges)};
+        }
+        return BuildRouteAllPairs(from, to);
+    }
+
+    // Для all_pairs перебираются все пары точек по матрице, остальные маршрутизаторы ищут от всех точек сразу
+    template <typename Weight>
+    std::optional<typename Router<Weight>::EndpointsRouteInfo>
+    Router<Weight>::BuildRoute(const std::vector<RouteEndpoint<Weight>>& from, const std::vector<RouteEndpoint<Weight>>& to) const {
+        if (type_ == RouterType::BIDIRECTIONAL_DIJKSTRA) {
+            return ResolveEndpoints(BuildRouteBidirectional(from, to), from, to);
+        }
+        if (type_ == RouterType::CONTRACTION_HIERARCHIES) {
+            auto route = contraction_hierarchy_->BuildRoute(from, to);
+            if (!route) {
+                return std::nullopt;
+            }
+            return ResolveEndpoints(RouteInfo{route->weight, std::move(route->edges)}, from, to);
+        }
+        std::optional<EndpointsRouteInfo> result;
+        for (size_t from_index = 0; from_index < from.size(); ++from_index) {
+            for (size_t to_index = 0; to_index < to.size(); ++to_index) {
+                const auto route = GetRouteInternalData(from[from_index].vertex, to[to_index].vertex);
+                if (!route) {
+                    continue;
+                }
+                const Weight weight = from[from_index].weight + route->weight + to[to_index].weight;
+                if (!result || weight < result->route.weight) {
+                    result = EndpointsRouteInfo{RouteInfo{weight, {}}, from_index, to_index};
+                }
+            }
+        }
+        if (result) {
+            result->route.edges = BuildRouteAllPairs(from[result->from_index].vertex, to[result->to_index].vertex)->edges;
+        }
+        return result;
+    }
+
+    // all_pairs читает ячейки матрицы, иерархия сжатия считает "многие ко многим" через корзины,
+    // для bidirectional_dijkstra из каждого источника идёт один поиск Дейкстры до всех целей сразу
+    template <typename Weight>
+    std::vector<std::optional<Weight>> Router<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                                         const std::vector<VertexId>& to) const {
+        if (type_ == RouterType::CONTRACTION_HIERARCHIES) {
+            return contraction_hierarchy_->BuildWeightMatrix(from, to);
+        }
+        std::vector<std::optional<Weight>> result(from.size() * to.size());
+        if (type_ == RouterType::BIDIRECTIONAL_DIJKSTRA) {
+            std::vector<std::optional<Weight>> weights(graph_.GetVertexCount());
+            for (size_t source = 0; source < from.size(); ++source) {
+                BuildWeightRow(from[source], to, weights, result.data() + source * to.size());
+            }
+            return result;
+        }
+        for (size_t source = 0; source < from.size(); ++source) {
+            for (size_t target = 0; target < to.size(); ++target) {
+                if (const auto route = GetRouteInternalData(from[source], to[target])) {
+                    result[source * to.size() + target] = route->weight;
+                }
+            }
+        }
+        return result;
+    }
+
+    // Поиск Дейкстры от from, останавливается, когда окончательные веса получены для всех целей.
+    // weights - рабочий массив по числу вершин, после поиска снова пуст
+    template <typename Weight>
+    void Router<Weight>::BuildWeightRow(VertexId from, const std::vector<VertexId>& to, std::vector<std::optional<Weight>>& weights,
+                                        std::optional<Weight>* row) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        // число ещё не достигнутых целей для каждой вершины
+        std::unordered_map<VertexId, size_t> targets_left;
+        for (const VertexId target : to) {
+            if (target >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            ++targets_left[target];
+        }
+        size_t remaining = to.size();
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        std::vector<VertexId> touched{from};
+        weights[from] = ZERO_WEIGHT;
+        queue.emplace(ZERO_WEIGHT, from);
+        while (!queue.empty() && remaining > 0) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*weights[vertex] < weight) {
+                continue;
+            }
+            if (const auto it = targets_left.find(vertex); it != targets_left.end() && it->second > 0) {
+                remaining -= it->second;
+                it->second = 0;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate = weight + edge.weight;
+                if (!weights[edge.to]) {
+                    touched.push_back(edge.to);
+                } else if (!(candidate < *weights[edge.to])) {
+                    continue;
+                }
+                weights[edge.to] = candidate;
+                queue.emplace(candidate, edge.to);
+            }
+        }
+        for (size_t target = 0; target < to.size(); ++target) {
+            row[target] = weights[to[target]];
+        }
+        for (const VertexId vertex : touched) {
+            weights[vertex].reset();
+        }
+    }
+
+    // Находит, через какие точки прошёл маршрут: первая и последняя вершины маршрута, для пустого маршрута -
+    // общая вершина from и to с наименьшей суммой весов
+    template <typename Weight>
+    std::optional<typename Router<Weight>::EndpointsRouteInfo>
+    Router<Weight>::ResolveEndpoints(std::optional<RouteInfo> route, const std::vector<RouteEndpoint<Weight>>& from,
+                                     const std::vector<RouteEndpoint<Weight>>& to) const {
+        if (!route) {
+            return std::nullopt;
+        }
+        auto find_lightest = [](const std::vector<RouteEndpoint<Weight>>& endpoints, VertexId vertex) {
+            size_t result = endpoints.size();
+            for (size_t i = 0; i < endpoints.size(); ++i) {
+                if (endpoints[i].vertex == vertex && (result == endpoints.size() || endpoints[i].weight < endpoints[result].weight)) {
+                    result = i;
+                }
+            }
+            return result;
+        };
+        if (!route->edges.empty()) {
+            const size_t from_index = find_lightest(from, graph_.GetEdge(route->edges.front()).from);
+            const size_t to_index = find_lightest(to, graph_.GetEdge(route->edges.back()).to);
+            return EndpointsRouteInfo{std::move(*route), from_index, to_index};
+        }
+        std::optional<EndpointsRouteInfo> result;
+        for (size_t from_index = 0; from_index < from.size(); ++from_index) {
+            const size_t to_index = find_lightest(to, from[from_index].vertex);
+            if (to_index == to.size()) {
+                continue;
+            }
+            if (!result || from[from_index].weight + to[to_index].weight
+                           < from[result->from_index].weight + to[result->to_index].weight) {
+                result = EndpointsRouteInfo{RouteInfo{route->weight, {}}, from_index, to_index};
+            }
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRouteAllPairs(VertexId from, VertexId to) const {
+        const auto route_internal_data = GetRouteInternalData(from, to);
         if (!route_internal_data) {
             return std::nullopt;
         }
         const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
         for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge; edge_id;
-             edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge){
+             edge_id = GetRouteInternalData(from, graph_.GetEdge(*edge_id).from)->prev_edge){
             edges.emplace_back(*edge_id);
         }
         std::reverse(edges.begin(), edges.end());
         return RouteInfo{weight, std::move(edges)};
     }
-}  // namespace graph
\ No newline at end of file
+
+    template <typename Weight>
+    std::optional<typename Router<Weight>::RouteInternalData> Router<Weight>::GetRouteInternalData(VertexId from, VertexId to) const {
+        if (!mapped_routes_) {
+            return routes_internal_data_.at(from).at(to);
+        }
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const RouteCell& cell = mapped_routes_[from * vertex_count + to];
+        if (cell.state == RouteCellState::NO_ROUTE) {
+            return std::nullopt;
+        }
+        RouteInternalData result{cell.weight, std::nullopt};
+        if (cell.state == RouteCellState::HAS_PREV_EDGE) {
+            result.prev_edge = cell.prev_edge;
+        }
+        return result;
+    }
+
+    // Все структуры поиска локальны для запроса, поэтому BuildRoute можно вызывать из нескольких потоков
+    template <typename Weight>
+    std::optional<typename Router<Weight>::RouteInfo>
+    Router<Weight>::BuildRouteBidirectional(const std::vector<RouteEndpoint<Weight>>& from,
+                                            const std::vector<RouteEndpoint<Weight>>& to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+        // для прямого поиска prev_edge - ребро, по которому пришли в вершину,
+        // для обратного - ребро, по которому из вершины уходим в сторону to
+        std::vector<std::optional<RouteInternalData>> forward(vertex_count);
+        std::vector<std::optional<RouteInternalData>> backward(vertex_count);
+        std::vector<bool> forward_settled(vertex_count, false);
+        std::vector<bool> backward_settled(vertex_count, false);
+        Queue forward_queue;
+        Queue backward_queue;
+        // несколько начальных (конечных) точек кладутся в очередь сразу, каждая со своим весом
+        auto seed = [vertex_count](const std::vector<RouteEndpoint<Weight>>& endpoints,
+                                   std::vector<std::optional<RouteInternalData>>& data, Queue& queue) {
+            for (const auto& [vertex, weight] : endpoints) {
+                if (vertex >= vertex_count) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                if (!data[vertex] || weight < data[vertex]->weight) {
+                    data[vertex] = RouteInternalData{weight, std::nullopt};
+                    queue.emplace(weight, vertex);
+                }
+            }
+        };
+        seed(from, forward, forward_queue);
+        seed(to, backward, backward_queue);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = 0;
+        auto update_best = [&](VertexId vertex) {
+            if (forward[vertex] && backward[vertex]) {
+                const Weight candidate = forward[vertex]->weight + backward[vertex]->weight;
+                if (!best_weight || candidate < *best_weight) {
+                    best_weight = candidate;
+                    meeting_vertex = vertex;
+                }
+            }
+        };
+
+        for (const auto& endpoint : from) {
+            update_best(endpoint.vertex);
+        }
+        while (!forward_queue.empty() && !backward_queue.empty()) {
+            if (best_weight && !(forward_queue.top().first + backward_queue.top().first < *best_weight)) {
+                break;
+            }
+            const bool forward_step = forward_queue.top().first <= backward_queue.top().first;
+            Queue& queue = forward_step ? forward_queue : backward_queue;
+            auto& data = forward_step ? forward : backward;
+            auto& settled = forward_step ? forward_settled : backward_settled;
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (settled[vertex]) {
+                continue;
+            }
+            settled[vertex] = true;
+            auto relax = [&](EdgeId edge_id) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const VertexId next = forward_step ? edge.to : edge.from;
+                const Weight candidate = weight + edge.weight;
+                if (!data[next] || candidate < data[next]->weight) {
+                    data[next] = RouteInternalData{candidate, edge_id};
+                    queue.emplace(candidate, next);
+                    update_best(next);
+                }
+            };
+            if (forward_step) {
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                    relax(edge_id);
+                }
+            } else {
+                for (EdgeId i = reverse_offsets_[vertex]; i < reverse_offsets_[vertex + 1]; ++i) {
+                    relax(reverse_edges_[i]);
+                }
+            }
+        }
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (std::optional<EdgeId> edge_id = forward[meeting_vertex]->prev_edge; edge_id;
+             edge_id = forward[graph_.GetEdge(*edge_id).from]->prev_edge) {
+            edges.emplace_back(*edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (std::optional<EdgeId> edge_id = backward[meeting_vertex]->prev_edge; edge_id;
+             edge_id = backward[graph_.GetEdge(*edge_id).to]->prev_edge) {
+            edges.emplace_back(*edge_id);
+        }
+        return RouteInfo{*best_weight, std::move(edges)};
+    }
+}  // namespace graph
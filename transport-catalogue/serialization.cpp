@@ -5,7 +5,7 @@
 tc_serialize::Stop SerializeStop(const transport::Stop& stop) {
     tc_serialize::Stop result;
     result.set_id_stop(stop.id);
-    result.set_name(stop.stop_name);
+    result.set_name(std::string{stop.stop_name});
     *result.mutable_coords() = SerializeCoordinates(stop.coordinates);
     return result;
 }
@@ -114,6 +114,7 @@ tc_serialize::RenderSettings SerializeRendererSettings(const RendererSettings& s
     for (const svg::Color& color: settings.color_palette) {
         *result.add_color_palette() = std::move(SerializeColor(color));
     }
+    result.set_line_simplification_tolerance(settings.line_simplification_tolerance);
     return std::move(result);
 }
 RendererSettings DeserializeRenderSetting(const tc_serialize::RenderSettings& settings) {
@@ -132,6 +133,7 @@ RendererSettings DeserializeRenderSetting(const tc_serialize::RenderSettings& se
     for (int i = 0; i < settings.color_palette_size(); ++i) {
         result.color_palette.emplace_back(std::move(DeserializeColor(settings.color_palette(i))));
     }
+    result.line_simplification_tolerance = settings.line_simplification_tolerance();
     return std::move(result);
 }
 
@@ -139,11 +141,46 @@ tc_serialize::RoutingSettings SerializeRouting(const RoutingSettings& settings)
     tc_serialize::RoutingSettings result;
     result.set_bus_wait_time(settings.bus_wait_time);
     result.set_bus_velocity(settings.bus_velocity);
+    result.set_router_type(SerializeRouterType(settings.router_type));
+    result.set_graph_model(settings.graph_model == GraphModel::RIDE_VERTICES ? 1 : 0);
+    result.set_pedestrian_velocity(settings.pedestrian_velocity);
+    result.set_walk_stop_count(settings.walk_stop_count);
     return std::move(result);
 }
 RoutingSettings DeserializeRouting(const tc_serialize::RoutingSettings& settings) {
     RoutingSettings result{};
     result.bus_wait_time = settings.bus_wait_time();
     result.bus_velocity = settings.bus_velocity();
+    result.router_type = DeserializeRouterType(settings.router_type());
+    result.graph_model = settings.graph_model() == 1 ? GraphModel::RIDE_VERTICES : GraphModel::STOP_PAIRS;
+    if (settings.pedestrian_velocity() > 0) {
+        result.pedestrian_velocity = settings.pedestrian_velocity();
+    }
+    if (settings.walk_stop_count() > 0) {
+        result.walk_stop_count = settings.walk_stop_count();
+    }
     return result;
-}
\ No newline at end of file
+}
+
+tc_serialize::RouterTypePB SerializeRouterType(graph::RouterType type) {
+    switch (type) {
+        case graph::RouterType::BIDIRECTIONAL_DIJKSTRA:
+            return tc_serialize::ROUTER_TYPE_BIDIRECTIONAL_DIJKSTRA;
+        case graph::RouterType::CONTRACTION_HIERARCHIES:
+            return tc_serialize::ROUTER_TYPE_CONTRACTION_HIERARCHIES;
+        default:
+            return tc_serialize::ROUTER_TYPE_ALL_PAIRS;
+    }
+}
+
+// Неизвестные номера, как и прежде, читаются как all_pairs
+graph::RouterType DeserializeRouterType(tc_serialize::RouterTypePB type) {
+    switch (type) {
+        case tc_serialize::ROUTER_TYPE_BIDIRECTIONAL_DIJKSTRA:
+            return graph::RouterType::BIDIRECTIONAL_DIJKSTRA;
+        case tc_serialize::ROUTER_TYPE_CONTRACTION_HIERARCHIES:
+            return graph::RouterType::CONTRACTION_HIERARCHIES;
+        default:
+            return graph::RouterType::ALL_PAIRS;
+    }
+}
@@ -7,10 +7,14 @@
 
 struct SerializationSettings {
     std::string file_name;
+    std::string router_file; // необязательный файл для данных маршрутизатора, отображаемый в память
 };
 
 struct RendererSettings;
 struct RoutingSettings;
+namespace graph {
+    enum class RouterType;
+}
 
 geo::Coordinates DeserializeCoordinates(const tc_serialize::Coordinates& coords);
 svg::Point DeserializePoint(const tc_serialize::Point& p);
@@ -28,4 +32,6 @@ tc_serialize::RenderSettings SerializeRendererSettings(const RendererSettings& s
 tc_serialize::RoutingSettings SerializeRouting(const RoutingSettings& settings);
 RendererSettings DeserializeRenderSetting(const tc_serialize::RenderSettings& settings);
 RoutingSettings DeserializeRouting(const tc_serialize::RoutingSettings& settings);
+tc_serialize::RouterTypePB SerializeRouterType(graph::RouterType type);
+graph::RouterType DeserializeRouterType(tc_serialize::RouterTypePB type);
 transport::Stop DeserializeStop(const tc_serialize::Stop& stop);
@@ -0,0 +1,254 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+
+namespace transport {
+    namespace {
+        // на чётной глубине дерево делится по широте, на нечётной - по долготе
+        double SplitKey(geo::Coordinates point, size_t depth) {
+            return depth % 2 == 0 ? point.latitude : point.longitude;
+        }
+
+        // Нижняя граница расстояния от точки до остановок по другую сторону разбиения
+        double DistanceToSplit(geo::Coordinates point, double split, size_t depth) {
+            if (depth % 2 == 0) {
+                return geo::ComputeDistanceToParallel(point, split);
+            }
+            // полоса долгот по другую сторону ограничена меридианом разбиения и линией перемены дат
+            return std::min(geo::ComputeDistanceToMeridian(point, split), geo::ComputeDistanceToMeridian(point, 180.));
+        }
+
+        bool Intersects(geo::Coordinates lhs_min, geo::Coordinates lhs_max, geo::Coordinates rhs_min, geo::Coordinates rhs_max) {
+            return lhs_min.latitude <= rhs_max.latitude && rhs_min.latitude <= lhs_max.latitude
+                   && lhs_min.longitude <= rhs_max.longitude && rhs_min.longitude <= lhs_max.longitude;
+        }
+    }
+
+    void StopSpatialIndex::Build(const std::deque<Stop>& stops) {
+        order_.resize(stops.size());
+        for (size_t i = 0; i < stops.size(); ++i) {
+            order_[i] = stops[i].id;
+        }
+        BuildRange(0, order_.size(), 0, stops);
+        points_.clear();
+        points_.reserve(order_.size());
+        for (const StopId id : order_) {
+            points_.push_back(stops[id - 1].coordinates);
+        }
+        built_ = true;
+    }
+
+    void StopSpatialIndex::BuildRange(size_t begin, size_t end, size_t depth, const std::deque<Stop>& stops) {
+        if (end - begin < 2) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        std::nth_element(order_.begin() + begin, order_.begin() + mid, order_.begin() + end,
+                         [&stops, depth](StopId lhs, StopId rhs) {
+            return SplitKey(stops[lhs - 1].coordinates, depth) < SplitKey(stops[rhs - 1].coordinates, depth);
+        });
+        BuildRange(begin, mid, depth + 1, stops);
+        BuildRange(mid + 1, end, depth + 1, stops);
+    }
+
+    bool StopSpatialIndex::Restore(const std::deque<Stop>& stops, std::vector<StopId> order) {
+        if (order.size() != stops.size()) {
+            return false;
+        }
+        std::vector<bool> seen(stops.size() + 1, false);
+        for (const StopId id : order) {
+            if (id == 0 || id > stops.size() || seen[id]) {
+                return false;
+            }
+            seen[id] = true;
+        }
+        order_ = std::move(order);
+        points_.clear();
+        points_.reserve(order_.size());
+        for (const StopId id : order_) {
+            points_.push_back(stops[id - 1].coordinates);
+        }
+        built_ = true;
+        return true;
+    }
+
+    const std::vector<StopId>& StopSpatialIndex::GetOrder() const {
+        return order_;
+    }
+
+    bool StopSpatialIndex::IsBuilt() const {
+        return built_;
+    }
+
+    std::vector<std::pair<StopId, double>> StopSpatialIndex::FindNearest(geo::Coordinates point, size_t count) const {
+        std::vector<Candidate> heap;
+        if (count == 0) {
+            return {};
+        }
+        heap.reserve(std::min(count, order_.size()));
+        SearchNearest(0, order_.size(), 0, point, count, heap);
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<std::pair<StopId, double>> result;
+        result.reserve(heap.size());
+        for (const auto& [distance, id] : heap) {
+            result.emplace_back(id, distance);
+        }
+        return result;
+    }
+
+    void StopSpatialIndex::SearchNearest(size_t begin, size_t end, size_t depth, geo::Coordinates point, size_t count,
+                                         std::vector<Candidate>& heap) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        // в куче лежат лучшие найденные кандидаты, на вершине - худший из них
+        const Candidate candidate{geo::ComputeDistanceHaversine(point, points_[mid]), order_[mid]};
+        if (heap.size() < count) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (candidate < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end());
+        }
+        const double split = SplitKey(points_[mid], depth);
+        const bool point_before = SplitKey(point, depth) < split;
+        if (point_before) {
+            SearchNearest(begin, mid, depth + 1, point, count, heap);
+        } else {
+            SearchNearest(mid + 1, end, depth + 1, point, count, heap);
+        }
+        if (heap.size() == count && DistanceToSplit(point, split, depth) > heap.front().first) {
+            return;
+        }
+        if (point_before) {
+            SearchNearest(mid + 1, end, depth + 1, point, count, heap);
+        } else {
+            SearchNearest(begin, mid, depth + 1, point, count, heap);
+        }
+    }
+
+    std::vector<StopId> StopSpatialIndex::FindInBox(geo::Coordinates min, geo::Coordinates max) const {
+        std::vector<StopId> result;
+        SearchBox(0, order_.size(), 0, min, max, result);
+        return result;
+    }
+
+    void StopSpatialIndex::SearchBox(size_t begin, size_t end, size_t depth, geo::Coordinates min, geo::Coordinates max,
+                                     std::vector<StopId>& result) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        const geo::Coordinates& point = points_[mid];
+        if (point.latitude >= min.latitude && point.latitude <= max.latitude
+            && point.longitude >= min.longitude && point.longitude <= max.longitude) {
+            result.push_back(order_[mid]);
+        }
+        const double split = SplitKey(point, depth);
+        if (SplitKey(min, depth) <= split) {
+            SearchBox(begin, mid, depth + 1, min, max, result);
+        }
+        if (SplitKey(max, depth) >= split) {
+            SearchBox(mid + 1, end, depth + 1, min, max, result);
+        }
+    }
+
+    void RouteSegmentIndex::Build(const std::deque<BusRoute>& bus_routes) {
+        std::vector<RouteSegment> segments;
+        std::vector<Box> boxes;
+        for (size_t bus_id = 0; bus_id < bus_routes.size(); ++bus_id) {
+            const auto& route_stops = bus_routes[bus_id].route_stops;
+            for (size_t position = 0; position + 1 < route_stops.size(); ++position) {
+                const geo::Coordinates from = route_stops[position]->coordinates;
+                const geo::Coordinates to = route_stops[position + 1]->coordinates;
+                segments.push_back({static_cast<uint32_t>(bus_id), static_cast<uint32_t>(position)});
+                boxes.push_back({{std::min(from.latitude, to.latitude), std::min(from.longitude, to.longitude)},
+                                 {std::max(from.latitude, to.latitude), std::max(from.longitude, to.longitude)}});
+            }
+        }
+        // дерево строится перестановкой номеров отрезков, затем отрезки и прямоугольники раскладываются в её порядке
+        std::vector<uint32_t> order(segments.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        BuildRange(order, 0, order.size(), 0, boxes);
+        segments_.clear();
+        boxes_.clear();
+        segments_.reserve(order.size());
+        boxes_.reserve(order.size());
+        for (const uint32_t index : order) {
+            segments_.push_back(segments[index]);
+            boxes_.push_back(boxes[index]);
+        }
+        subtree_boxes_.resize(boxes_.size());
+        if (!boxes_.empty()) {
+            ComputeSubtreeBox(0, boxes_.size());
+        }
+        built_ = true;
+    }
+
+    void RouteSegmentIndex::BuildRange(std::vector<uint32_t>& order, size_t begin, size_t end, size_t depth,
+                                       const std::vector<Box>& boxes) {
+        if (end - begin < 2) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        // сумма координат концов прямоугольника вместо середины, порядок от этого не меняется
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&boxes, depth](uint32_t lhs, uint32_t rhs) {
+            return depth % 2 == 0
+                   ? boxes[lhs].min.latitude + boxes[lhs].max.latitude < boxes[rhs].min.latitude + boxes[rhs].max.latitude
+                   : boxes[lhs].min.longitude + boxes[lhs].max.longitude < boxes[rhs].min.longitude + boxes[rhs].max.longitude;
+        });
+        BuildRange(order, begin, mid, depth + 1, boxes);
+        BuildRange(order, mid + 1, end, depth + 1, boxes);
+    }
+
+    RouteSegmentIndex::Box RouteSegmentIndex::ComputeSubtreeBox(size_t begin, size_t end) {
+        const size_t mid = begin + (end - begin) / 2;
+        Box subtree = boxes_[mid];
+        auto extend = [&subtree](const Box& box) {
+            subtree.min = {std::min(subtree.min.latitude, box.min.latitude), std::min(subtree.min.longitude, box.min.longitude)};
+            subtree.max = {std::max(subtree.max.latitude, box.max.latitude), std::max(subtree.max.longitude, box.max.longitude)};
+        };
+        if (begin < mid) {
+            extend(ComputeSubtreeBox(begin, mid));
+        }
+        if (mid + 1 < end) {
+            extend(ComputeSubtreeBox(mid + 1, end));
+        }
+        subtree_boxes_[mid] = subtree;
+        return subtree;
+    }
+
+    bool RouteSegmentIndex::IsBuilt() const {
+        return built_;
+    }
+
+    std::vector<RouteSegment> RouteSegmentIndex::FindInBox(geo::Coordinates min, geo::Coordinates max) const {
+        std::vector<RouteSegment> result;
+        SearchBox(0, segments_.size(), {min, max}, result);
+        std::sort(result.begin(), result.end(), [](const RouteSegment& lhs, const RouteSegment& rhs) {
+            return std::pair(lhs.bus_id, lhs.position) < std::pair(rhs.bus_id, rhs.position);
+        });
+        return result;
+    }
+
+    void RouteSegmentIndex::SearchBox(size_t begin, size_t end, const Box& box, std::vector<RouteSegment>& result) const {
+        if (begin >= end) {
+            return;
+        }
+        const size_t mid = begin + (end - begin) / 2;
+        if (!Intersects(subtree_boxes_[mid].min, subtree_boxes_[mid].max, box.min, box.max)) {
+            return;
+        }
+        if (Intersects(boxes_[mid].min, boxes_[mid].max, box.min, box.max)) {
+            result.push_back(segments_[mid]);
+        }
+        SearchBox(begin, mid, box, result);
+        SearchBox(mid + 1, end, box, result);
+    }
+
+}  // namespace transport
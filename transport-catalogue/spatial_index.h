@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+
+namespace transport {
+
+/*
+ * Неявное k-d дерево по координатам остановок: id остановок переставлены так, что средний элемент любого
+ * отрезка делит его по широте (на чётной глубине) или по долготе (на нечётной). Дерево хранится одним
+ * массивом без указателей, поэтому порядок id можно сохранить в базу и восстановить без перестроения.
+ * Поиск ближайших отсекает поддеревья по точному расстоянию до параллели или меридиана разбиения.
+ */
+    class StopSpatialIndex {
+    public:
+        void Build(const std::deque<Stop>& stops);
+        // Восстанавливает дерево по сохранённому порядку id, false - порядок не подходит к остановкам
+        bool Restore(const std::deque<Stop>& stops, std::vector<StopId> order);
+        // id остановок в порядке дерева
+        const std::vector<StopId>& GetOrder() const;
+        bool IsBuilt() const;
+
+        // Не больше count ближайших остановок с расстояниями в метрах, по возрастанию расстояния (при равенстве - по id)
+        std::vector<std::pair<StopId, double>> FindNearest(geo::Coordinates point, size_t count) const;
+        // Остановки внутри прямоугольника, включая границы, в порядке дерева
+        std::vector<StopId> FindInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+    private:
+        using Candidate = std::pair<double, StopId>;
+
+        void BuildRange(size_t begin, size_t end, size_t depth, const std::deque<Stop>& stops);
+        void SearchNearest(size_t begin, size_t end, size_t depth, geo::Coordinates point, size_t count,
+                           std::vector<Candidate>& heap) const;
+        void SearchBox(size_t begin, size_t end, size_t depth, geo::Coordinates min, geo::Coordinates max,
+                       std::vector<StopId>& result) const;
+
+        std::vector<StopId> order_;
+        // координаты в порядке дерева, чтобы обход не переходил к остановкам справочника
+        std::vector<geo::Coordinates> points_;
+        bool built_ = false;
+    };
+
+    // Отрезок маршрута между остановками с номерами position и position + 1 в route_stops автобуса bus_id
+    struct RouteSegment {
+        uint32_t bus_id = 0;
+        uint32_t position = 0;
+    };
+
+/*
+ * Неявное дерево ограничивающих прямоугольников отрезков маршрутов: отрезки упорядочены, как остановки
+ * в StopSpatialIndex, по широте и долготе своих середин, а для среднего элемента каждого отрезка массива
+ * хранится прямоугольник, охватывающий все отрезки этого поддерева. Поиск не заходит в поддеревья,
+ * прямоугольник которых не пересекается с запрошенным. Индекс строится по маршрутам заново и в базу не сохраняется.
+ */
+    class RouteSegmentIndex {
+    public:
+        void Build(const std::deque<BusRoute>& bus_routes);
+        bool IsBuilt() const;
+
+        // Отрезки, прямоугольник которых пересекается с заданным (включая границы), по возрастанию автобуса и позиции
+        std::vector<RouteSegment> FindInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+    private:
+        struct Box {
+            geo::Coordinates min;
+            geo::Coordinates max;
+        };
+
+        static void BuildRange(std::vector<uint32_t>& order, size_t begin, size_t end, size_t depth,
+                               const std::vector<Box>& boxes);
+        // пустой отрезок массива не передаётся
+        Box ComputeSubtreeBox(size_t begin, size_t end);
+        void SearchBox(size_t begin, size_t end, const Box& box, std::vector<RouteSegment>& result) const;
+
+        std::vector<RouteSegment> segments_;
+        // прямоугольник каждого отрезка в порядке дерева
+        std::vector<Box> boxes_;
+        // прямоугольник поддерева с корнем в этом элементе
+        std::vector<Box> subtree_boxes_;
+        bool built_ = false;
+    };
+
+}  // namespace transport
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace transport {
+
+/*
+ * Хранилище строк только на добавление: строки копируются в крупные блоки и больше не перемещаются,
+ * поэтому string_view на них остаются действительными всё время жизни хранилища.
+ * Заменяет отдельный std::string (и отдельное выделение памяти) на каждое имя остановки и автобуса.
+ */
+    class StringArena {
+    public:
+        StringArena() = default;
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+        StringArena(StringArena&&) = default;
+        StringArena& operator=(StringArena&&) = default;
+
+        std::string_view Store(std::string_view str) {
+            if (str.empty()) {
+                return {};
+            }
+            if (str.size() > block_free_) {
+                // строка длиннее блока получает собственный блок, остаток текущего блока не теряется
+                if (str.size() > BLOCK_SIZE / 4) {
+                    return Copy(AllocateBlock(str.size()), str);
+                }
+                block_pos_ = AllocateBlock(BLOCK_SIZE);
+                block_free_ = BLOCK_SIZE;
+            }
+            const std::string_view result = Copy(block_pos_, str);
+            block_pos_ += str.size();
+            block_free_ -= str.size();
+            return result;
+        }
+
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        char* AllocateBlock(size_t size) {
+            return blocks_.emplace_back(new char[size]).get();
+        }
+
+        static std::string_view Copy(char* dest, std::string_view str) {
+            std::copy(str.begin(), str.end(), dest);
+            return {dest, str.size()};
+        }
+
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* block_pos_ = nullptr;
+        size_t block_free_ = 0;
+    };
+
+}  // namespace transport
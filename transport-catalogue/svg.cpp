@@ -1,5 +1,8 @@
 #include "svg.h"
+#include <charconv>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 using namespace std;
 using namespace std::literals;
 namespace svg {
@@ -29,7 +32,31 @@ namespace svg {
                    << to_string(rgba.red) << ","s
                    << to_string(rgba.green) << ","s
                    << to_string(rgba.blue) << ","s
-                   << rgba.opacity << ")"s;
+                   << Number{rgba.opacity} << ")"s;
+    }
+// ---------- Number ------------------
+    namespace {
+        // точность по умолчанию у std::ostream и "%g"
+        constexpr int NUMBER_PRECISION = 6;
+        // хватает для "%g" с шестью цифрами: знак, точка, экспонента
+        constexpr size_t NUMBER_BUFFER_SIZE = 32;
+        // размер буфера PackedDocument::Render, после которого текст сбрасывается в поток
+        constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+        string_view FormatNumber(double value, char (&buffer)[NUMBER_BUFFER_SIZE]) {
+            const auto [end, ec] = to_chars(begin(buffer), std::end(buffer), value, chars_format::general, NUMBER_PRECISION);
+            return {buffer, static_cast<size_t>(end - buffer)};
+        }
+    }
+
+    ostream& operator<<(ostream& out, Number number) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        return out << FormatNumber(number.value, buffer);
+    }
+
+    void AppendNumber(string& out, double value) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        out.append(FormatNumber(value, buffer));
     }
 
     void ColorPrinter::operator()(std::monostate) {
@@ -81,6 +108,34 @@ namespace svg {
         return out;
     }
 
+    namespace {
+        // экранирование текста совпадает с Text::RenderObject
+        void AppendTextData(string& out, string_view data) {
+            for (const auto& c : data) {
+                switch (c) {
+                    case '"':
+                        out += "&quot;"sv;
+                        break;
+                    case '\'':
+                        out += "&apos;"sv;
+                        break;
+                    case '<':
+                        out += "&lt;"sv;
+                        break;
+                    case '>':
+                        out += "&gt;"sv;
+                        break;
+                    case '&':
+                        out += "&amp;"sv;
+                        break;
+                    default:
+                        out += c;
+                        break;
+                }
+            }
+        }
+    }
+
     void Object::Render(const RenderContext& context) const {
         context.RenderIndent();
         RenderObject(context);
@@ -101,8 +156,8 @@ namespace svg {
 
     void Circle::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
-        out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\""sv;
-        out << " r=\""sv << radius_ << "\""sv;
+        out << "<circle cx=\""sv << Number{center_.x} << "\" cy=\""sv << Number{center_.y} << "\""sv;
+        out << " r=\""sv << Number{radius_} << "\""sv;
         RenderAttrs(out);
         out << " />"sv;
     }
@@ -123,7 +178,7 @@ namespace svg {
                 out << " "sv;
             }
             isFirst = false;
-            out << point.x << ","sv << point.y;
+            out << Number{point.x} << ","sv << Number{point.y};
         }
         out << "\""s;
         RenderAttrs(out);
@@ -164,10 +219,10 @@ namespace svg {
     void Text::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<text"sv
-            << " x=\""sv << pos_.x << "\""sv
-            << " y=\""sv << pos_.y << "\""sv
-            << " dx=\""sv << offset_.x << "\""sv
-            << " dy=\""sv << offset_.y << "\""sv
+            << " x=\""sv << Number{pos_.x} << "\""sv
+            << " y=\""sv << Number{pos_.y} << "\""sv
+            << " dx=\""sv << Number{offset_.x} << "\""sv
+            << " dy=\""sv << Number{offset_.y} << "\""sv
             << " font-size=\""sv << size_ << "\""sv;
         if (font_family_) {
             out << " font-family=\""sv << *font_family_ << "\""sv;
@@ -178,28 +233,9 @@ namespace svg {
         RenderAttrs(out);
         out << ">"sv;
 
-        for (const auto& c : data_) {
-            switch (c) {
-                case '"':
-                    out << "&quot;";
-                    break;
-                case '\'':
-                    out << "&apos;";
-                    break;
-                case '<':
-                    out << "&lt;";
-                    break;
-                case '>':
-                    out << "&gt;";
-                    break;
-                case '&':
-                    out << "&amp;";
-                    break;
-                default:
-                    out << c;
-                    break;
-            }
-        } out << "</text>"sv;
+        string data;
+        AppendTextData(data, data_);
+        out << data << "</text>"sv;
     }
 
 // ---------- Document ------------------
@@ -218,4 +254,129 @@ namespace svg {
         }
         out << "</svg>"sv;
     }
-}  // namespace svg
\ No newline at end of file
+
+// ---------- PackedDocument ------------------
+
+    StyleId PackedDocument::AddStyle(Style style) {
+        styles_.push_back(move(style));
+        return static_cast<StyleId>(styles_.size() - 1);
+    }
+
+    void PackedDocument::AddCircle(Point center, double radius, StyleId style) {
+        order_.emplace_back(Kind::CIRCLE, static_cast<uint32_t>(circles_.size()));
+        circles_.push_back({center, radius, style});
+    }
+
+    void PackedDocument::StartPolyline(StyleId style) {
+        order_.emplace_back(Kind::POLYLINE, static_cast<uint32_t>(polylines_.size()));
+        polylines_.push_back({points_.size(), 0, style});
+    }
+
+    void PackedDocument::AddPolylinePoint(Point point) {
+        if (polylines_.empty()) {
+            throw logic_error("Polyline is not started");
+        }
+        points_.push_back(point);
+        ++polylines_.back().point_count;
+    }
+
+    void PackedDocument::AddText(Point position, string_view data, StyleId style) {
+        order_.emplace_back(Kind::TEXT, static_cast<uint32_t>(texts_.size()));
+        texts_.push_back({position, text_data_.size(), data.size(), style});
+        text_data_.append(data);
+    }
+
+    void PackedDocument::Render(std::ostream& out) const {
+        // атрибуты оформления форматируются один раз: path_attrs - как PathProps::RenderAttrs,
+        // text_attrs - атрибуты Text от dx до font-weight
+        vector<string> path_attrs;
+        vector<string> text_attrs;
+        path_attrs.reserve(styles_.size());
+        text_attrs.reserve(styles_.size());
+        for (const Style& style : styles_) {
+            ostringstream attrs;
+            if (style.fill_color) {
+                attrs << " fill=\""sv << *style.fill_color << "\""sv;
+            }
+            if (style.stroke_color) {
+                attrs << " stroke=\""sv << *style.stroke_color << "\""sv;
+            }
+            if (style.stroke_width) {
+                attrs << " stroke-width=\""sv << Number{*style.stroke_width} << "\""sv;
+            }
+            if (style.stroke_linecap) {
+                attrs << " stroke-linecap=\""sv << *style.stroke_linecap << "\""sv;
+            }
+            if (style.stroke_linejoin) {
+                attrs << " stroke-linejoin=\""sv << *style.stroke_linejoin << "\""sv;
+            }
+            path_attrs.push_back(attrs.str());
+            ostringstream text;
+            text << " dx=\""sv << Number{style.text_offset.x} << "\""sv
+                 << " dy=\""sv << Number{style.text_offset.y} << "\""sv
+                 << " font-size=\""sv << style.font_size << "\""sv;
+            if (style.font_family) {
+                text << " font-family=\""sv << *style.font_family << "\""sv;
+            }
+            if (style.font_weight) {
+                text << " font-weight=\""sv << *style.font_weight << "\""sv;
+            }
+            text_attrs.push_back(text.str());
+        }
+
+        // документ собирается в строку, которая сбрасывается в поток порциями
+        string buffer;
+        buffer.reserve(FLUSH_SIZE + FLUSH_SIZE / 4);
+        buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        buffer += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+        for (const auto& [kind, index] : order_) {
+            buffer += "  "sv;
+            if (kind == Kind::CIRCLE) {
+                const CircleRecord& circle = circles_[index];
+                buffer += "<circle cx=\""sv;
+                AppendNumber(buffer, circle.center.x);
+                buffer += "\" cy=\""sv;
+                AppendNumber(buffer, circle.center.y);
+                buffer += "\" r=\""sv;
+                AppendNumber(buffer, circle.radius);
+                buffer += '"';
+                buffer += path_attrs.at(circle.style);
+                buffer += " />"sv;
+            } else if (kind == Kind::POLYLINE) {
+                const PolylineRecord& polyline = polylines_[index];
+                buffer += "<polyline points=\""sv;
+                for (size_t i = 0; i < polyline.point_count; ++i) {
+                    if (i > 0) {
+                        buffer += ' ';
+                    }
+                    const Point& point = points_[polyline.first_point + i];
+                    AppendNumber(buffer, point.x);
+                    buffer += ',';
+                    AppendNumber(buffer, point.y);
+                }
+                buffer += '"';
+                buffer += path_attrs.at(polyline.style);
+                buffer += " />"sv;
+            } else {
+                const TextRecord& text = texts_[index];
+                buffer += "<text x=\""sv;
+                AppendNumber(buffer, text.position.x);
+                buffer += "\" y=\""sv;
+                AppendNumber(buffer, text.position.y);
+                buffer += '"';
+                buffer += text_attrs.at(text.style);
+                buffer += path_attrs[text.style];
+                buffer += '>';
+                AppendTextData(buffer, string_view(text_data_).substr(text.data_begin, text.data_size));
+                buffer += "</text>"sv;
+            }
+            buffer += '\n';
+            if (buffer.size() >= FLUSH_SIZE) {
+                out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        buffer += "</svg>"sv;
+        out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    }
+}  // namespace svg
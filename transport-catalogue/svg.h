@@ -4,6 +4,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <variant>
@@ -77,6 +78,18 @@ namespace svg {
         double y = 0;
     };
 
+/*
+ * Число для вывода в SVG. Формат совпадает с std::ostream по умолчанию (как printf "%g", 6 значащих цифр),
+ * но число форматируется через std::to_chars без обращения к локали и флагам потока
+ */
+    struct Number {
+        double value = 0;
+    };
+
+    std::ostream& operator<<(std::ostream& out, Number number);
+    // дописывает число в конец строки в том же формате
+    void AppendNumber(std::string& out, double value);
+
 /*
  * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
  * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
@@ -172,7 +185,7 @@ namespace svg {
                 out << " stroke=\""sv << *stroke_color_ << "\""sv;
             }
             if (stroke_width_) {
-                out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+                out << " stroke-width=\""sv << Number{*stroke_width_} << "\""sv;
             }
             if (stroke_linecap_) {
                 out << " stroke-linecap=\""sv << *stroke_linecap_ << "\""sv;
@@ -260,4 +273,73 @@ namespace svg {
     private:
         std::vector<std::unique_ptr<Object>> objects_;
     };
+
+    using StyleId = uint32_t;
+
+/*
+ * Оформление, общее для многих элементов PackedDocument: атрибуты PathProps,
+ * а для текста ещё смещение и шрифт. Атрибуты выводятся в том же порядке, что и у Circle, Polyline и Text
+ */
+    struct Style {
+        std::optional<Color> fill_color;
+        std::optional<Color> stroke_color;
+        std::optional<double> stroke_width;
+        std::optional<StrokeLineCap> stroke_linecap;
+        std::optional<StrokeLineJoin> stroke_linejoin;
+        Point text_offset;
+        uint32_t font_size = 1;
+        std::optional<std::string> font_family;
+        std::optional<std::string> font_weight;
+    };
+
+/*
+ * Документ SVG, хранящий элементы по значению: круги, ломаные и тексты лежат в отдельных непрерывных массивах
+ * (точки всех ломаных и строки всех текстов - в общих буферах), а порядок вывода задаёт массив пар (вид, номер).
+ * Элементы ссылаются на общее оформление по StyleId, его атрибуты форматируются один раз на Render.
+ * Вывод совпадает с Document из тех же Circle, Polyline и Text.
+ */
+    class PackedDocument {
+    public:
+        StyleId AddStyle(Style style);
+        void AddCircle(Point center, double radius, StyleId style);
+        // Точки новой ломаной добавляются следующими вызовами AddPolylinePoint
+        void StartPolyline(StyleId style);
+        void AddPolylinePoint(Point point);
+        void AddText(Point position, std::string_view data, StyleId style);
+        void Render(std::ostream& out) const;
+
+    private:
+        enum class Kind : uint8_t {
+            CIRCLE,
+            POLYLINE,
+            TEXT,
+        };
+
+        struct CircleRecord {
+            Point center;
+            double radius;
+            StyleId style;
+        };
+
+        struct PolylineRecord {
+            size_t first_point;
+            size_t point_count;
+            StyleId style;
+        };
+
+        struct TextRecord {
+            Point position;
+            size_t data_begin;
+            size_t data_size;
+            StyleId style;
+        };
+
+        std::vector<Style> styles_;
+        std::vector<std::pair<Kind, uint32_t>> order_;
+        std::vector<CircleRecord> circles_;
+        std::vector<PolylineRecord> polylines_;
+        std::vector<Point> points_;
+        std::vector<TextRecord> texts_;
+        std::string text_data_;
+    };
 }  // namespace svg
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "map_renderer.h"
+#include "svg.h"
+#include "transport_catalogue.h"
+
+/*
+ * Проверка, что быстрый вывод совпадает с прежним побайтно:
+ * числа через std::to_chars - с выводом double в std::ostream по умолчанию,
+ * карта и ответы на stat_requests - с файлами, которые вывела версия, печатавшая числа через std::ostream.
+ * Аргументы - файлы входных данных, например примеры из cmake-build-debug. Рядом с входным файлом <имя>.json
+ * должны лежать <имя>_expected_map.svg (карта) и <имя>_expected_answer.json (вывод process_requests).
+ */
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+    size_t failures = 0;
+
+    void Check(bool condition, const string& message) {
+        if (!condition) {
+            ++failures;
+            cerr << "FAILED: "sv << message << endl;
+        }
+    }
+
+    // ответ, каким его выводил json::PrintNode: словарь с ключом value
+    string PrintWithNode(json::Node value) {
+        ostringstream out;
+        json::PrintNode(json::Node{json::Dict{{"value"s, move(value)}}}, svg::RenderContext(out, 4));
+        return out.str();
+    }
+
+    template <typename Value>
+    string PrintWithWriter(const Value& value) {
+        ostringstream out;
+        {
+            json::Writer writer(out);
+            writer.StartDict().Key("value"sv).Value(value).EndDict();
+        }
+        return out.str();
+    }
+
+    void TestNumbers() {
+        const double min_denormal = numeric_limits<double>::denorm_min();
+        const vector<double> values{
+            // целые и их переход в экспоненту на седьмой цифре
+            0., 1., -1., 7., 42., 100., 123456., 999999., 1000000., -1000000., 1234567., 4294967296., 1e15, 1e16,
+            // отрицательный ноль
+            -0.,
+            // граница экспоненты для маленьких чисел: 1e-4 без неё, 1e-5 с ней
+            1e-4, 0.0001234567, 9.99999e-5, 9.999995e-5, 1e-5, -1e-5, 1.5e-5, 1e-6, 1e-300, min_denormal,
+            // граница 1e21, где меняется вывод у JavaScript, и соседние значения
+            1e20, 9.999999e20, 1e21, -1e21, 1e22, 1.7976931348623157e308,
+            // округление до шести значащих цифр, в том числе с переносом разряда
+            0.1, 0.2 + 0.1, 1. / 3., 2. / 3., 3.14159265, 123.4565, 123.4575, 0.1234565, 999999.5, 999999.4,
+            9.999995, 9.999994, 99999.95, 0.00999999, 1.0000005, 55.574371, 37.6517, 1.5, 2.5, -2.5,
+            numeric_limits<double>::infinity(), -numeric_limits<double>::infinity(),
+        };
+        for (const double value : values) {
+            ostringstream expected;
+            expected << value;
+            ostringstream number;
+            number << svg::Number{value};
+            Check(number.str() == expected.str(), "svg::Number "s + number.str() + " != "s + expected.str());
+            string appended = "x"s;
+            svg::AppendNumber(appended, value);
+            Check(appended == "x"s + expected.str(), "svg::AppendNumber "s + appended + " != x"s + expected.str());
+            const string printed = PrintWithNode(json::Node{value});
+            Check(printed == "{\n    \"value\": "s + expected.str() + "\n}"s, "json::PrintNode "s + printed);
+            const string written = PrintWithWriter(value);
+            Check(written == printed, "json::Writer "s + written + " != "s + printed);
+        }
+    }
+
+    string ReadFile(const string& file_name) {
+        ifstream input(file_name, ios::binary);
+        if (!input) {
+            Check(false, "can't open "s + file_name);
+            return {};
+        }
+        ostringstream content;
+        content << input.rdbuf();
+        return content.str();
+    }
+
+    void TestExample(const string& file_name) {
+        ifstream input(file_name);
+        if (!input) {
+            Check(false, "can't open "s + file_name);
+            return;
+        }
+        const string expected_prefix = file_name.substr(0, file_name.rfind(".json"s));
+        transport::TransportCatalogue tc;
+        json_reader::JsonReader reader(tc);
+        reader.InputStatReader(input);
+        ostringstream map;
+        MapRenderer(reader.GetRendererSetting()).RenderSvgMap(tc, map);
+        Check(map.str() == ReadFile(expected_prefix + "_expected_map.svg"s), file_name + ": map differs from the expected SVG"s);
+        ostringstream answer;
+        reader.OutputStatReader(answer);
+        Check(answer.str() == ReadFile(expected_prefix + "_expected_answer.json"s), file_name + ": answer differs from the expected one"s);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    TestNumbers();
+    for (int i = 1; i < argc; ++i) {
+        TestExample(argv[i]);
+    }
+    if (failures > 0) {
+        cerr << failures << " checks failed"sv << endl;
+        return 1;
+    }
+    cout << "svg_output_test OK"sv << endl;
+    return 0;
+}
@@ -1,7 +1,10 @@
 #include "transport_catalogue.h"
+#include <algorithm>
 #include <utility>
 #include <iostream>
+#include <numeric>
 #include <set>
+#include <stdexcept>
 
 namespace transport{
 
@@ -11,65 +14,194 @@ namespace transport{
     }
 
     void TransportCatalogue::AddStop(const Stop& stop) {
-        if (stops_index_.count(stop.stop_name) > 0) return;
+        if (stops_index_.Find(stop.stop_name) != nullptr) return;
         Stop* ptr = &stops_.emplace_back(stop);
-        if (ptr->id == 0){
-            ptr->id = ++stop_id_counter_;
+        ptr->id = static_cast<uint32_t>(stops_.size());
+        ptr->stop_name = names_.Store(stop.stop_name);
+        stops_index_.Insert(ptr->stop_name, ptr->id);
+        stop_distances_.emplace_back();
+        if (stop_bus_offsets_.empty()) {
+            stop_buses_.emplace_back();
         } else {
-            stop_id_counter_ = ptr->id;
+            stop_bus_offsets_.push_back(stop_bus_offsets_.back());
         }
-        std::string_view stop_name(ptr->stop_name);
-        stops_index_.emplace(stop_name, ptr);
-        stop_id_name_index_.emplace(ptr->id, ptr);
+        if (spatial_index_.IsBuilt()) {
+            spatial_index_.Build(stops_);
+        }
+    }
+
+    const Stop* TransportCatalogue::FindStopPtr(std::string_view name) const {
+        const uint32_t* id = stops_index_.Find(name);
+        return id == nullptr ? nullptr : &stops_[*id - 1];
     }
 
     std::pair<bool, const Stop&> TransportCatalogue::FindStop(const std::string_view name) const {
-        const auto it = stops_index_.find(name);
-        if (it == stops_index_.end()) {
+        const Stop* stop = FindStopPtr(name);
+        if (stop == nullptr) {
             return {false, EMPTY_STOP};
         }
-        return {true, *it->second};
+        return {true, *stop};
     }
 
     bool TransportCatalogue::AddBus(const BusRoute &bus_route) {
-        const auto it = routes_index_.find(bus_route.bus_name);
-        if (it != routes_index_.end()) { return false; }
-        const BusRoute* ptr = &bus_routes_.emplace_back(bus_route);
-        std::string_view bus_name (ptr->bus_name);
-        routes_index_.emplace(bus_name, ptr);
-        for (const Stop* stop : ptr->route_stops) {
-            stop_and_buses_[stop->stop_name].insert(bus_name);
-        }
+        if (routes_index_.Find(bus_route.bus_name) != nullptr) { return false; }
+        AddBusWithInfo(bus_route, ComputeBusInfo(bus_route));
         return true;
     }
 
+    void TransportCatalogue::AddBusWithInfo(const BusRoute &bus_route, const BusInfo &bus_info) {
+        BusRoute* ptr = &bus_routes_.emplace_back(bus_route);
+        ptr->bus_name = names_.Store(bus_route.bus_name);
+        const std::string_view bus_name = ptr->bus_name;
+        const auto bus_id = static_cast<uint32_t>(bus_routes_.size() - 1);
+        routes_index_.Insert(bus_name, bus_id);
+        if (stop_bus_offsets_.empty()) {
+            for (const Stop* stop : ptr->route_stops) {
+                auto& stop_buses = stop_buses_[stop->id - 1];
+                if (stop_buses.empty() || stop_buses.back() != bus_id) {
+                    stop_buses.push_back(bus_id);
+                }
+            }
+        } else {
+            AddBusToStopBusIndex(bus_id);
+        }
+        BusInfo& stored_info = bus_infos_.emplace_back(bus_info);
+        stored_info.bus_name = bus_name;
+        if (segment_index_.IsBuilt()) {
+            segment_index_.Build(bus_routes_);
+        }
+        if (!stop_bus_offsets_.empty()) {
+            BuildRouteOrder();
+        }
+    }
+
+    void TransportCatalogue::BuildIndexes() {
+        BuildStopBusIndex();
+        BuildRouteOrder();
+        spatial_index_.Build(stops_);
+        segment_index_.Build(bus_routes_);
+    }
+
+    void TransportCatalogue::BuildStopBusIndex() {
+        stop_bus_offsets_.assign(1, 0);
+        stop_bus_offsets_.reserve(stop_buses_.size() + 1);
+        stop_bus_ids_.clear();
+        for (const auto& stop_buses : stop_buses_) {
+            const auto begin = static_cast<std::ptrdiff_t>(stop_bus_ids_.size());
+            stop_bus_ids_.insert(stop_bus_ids_.end(), stop_buses.begin(), stop_buses.end());
+            std::sort(stop_bus_ids_.begin() + begin, stop_bus_ids_.end(), [this](uint32_t lhs, uint32_t rhs) {
+                return bus_routes_[lhs].bus_name < bus_routes_[rhs].bus_name;
+            });
+            stop_bus_offsets_.push_back(static_cast<uint32_t>(stop_bus_ids_.size()));
+        }
+        // дальше списки автобусов читаются только из упакованного массива
+        std::vector<std::vector<uint32_t>>().swap(stop_buses_);
+    }
+
+    void TransportCatalogue::AddBusToStopBusIndex(uint32_t bus_id) {
+        std::vector<bool> on_route(stops_.size(), false);
+        for (const Stop* stop : bus_routes_[bus_id].route_stops) {
+            on_route[stop->id - 1] = true;
+        }
+        const auto by_name = [this](uint32_t lhs, uint32_t rhs) {
+            return bus_routes_[lhs].bus_name < bus_routes_[rhs].bus_name;
+        };
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> ids;
+        offsets.reserve(stop_bus_offsets_.size());
+        ids.reserve(stop_bus_ids_.size() + bus_routes_[bus_id].route_stops.size());
+        offsets.push_back(0);
+        for (size_t stop = 0; stop < stops_.size(); ++stop) {
+            const auto begin = stop_bus_ids_.begin() + stop_bus_offsets_[stop];
+            const auto end = stop_bus_ids_.begin() + stop_bus_offsets_[stop + 1];
+            if (on_route[stop]) {
+                const auto position = std::lower_bound(begin, end, bus_id, by_name);
+                ids.insert(ids.end(), begin, position);
+                ids.push_back(bus_id);
+                ids.insert(ids.end(), position, end);
+            } else {
+                ids.insert(ids.end(), begin, end);
+            }
+            offsets.push_back(static_cast<uint32_t>(ids.size()));
+        }
+        stop_bus_offsets_ = std::move(offsets);
+        stop_bus_ids_ = std::move(ids);
+    }
+
+    void TransportCatalogue::BuildRouteOrder() {
+        buses_by_name_.resize(bus_routes_.size());
+        std::iota(buses_by_name_.begin(), buses_by_name_.end(), 0);
+        std::sort(buses_by_name_.begin(), buses_by_name_.end(), [this](uint32_t lhs, uint32_t rhs) {
+            return bus_routes_[lhs].bus_name < bus_routes_[rhs].bus_name;
+        });
+        route_orders_.assign(bus_routes_.size(), 0);
+        uint32_t order = 0;
+        for (const uint32_t bus_id : buses_by_name_) {
+            route_orders_[bus_id] = order;
+            if (!bus_routes_[bus_id].route_stops.empty()) {
+                ++order;
+            }
+        }
+    }
+
+    ranges::Range<const uint32_t*> TransportCatalogue::GetStopBuses(StopId stop_id) const {
+        if (stop_bus_offsets_.empty()) {
+            const auto& buses = stop_buses_[stop_id - 1];
+            return {buses.data(), buses.data() + buses.size()};
+        }
+        return {stop_bus_ids_.data() + stop_bus_offsets_[stop_id - 1], stop_bus_ids_.data() + stop_bus_offsets_[stop_id]};
+    }
+
     const BusRoute& TransportCatalogue::FindBus(std::string_view name) const {
-        const auto iter = routes_index_.find(name);
-        if (iter == routes_index_.end()) {
+        const uint32_t* index = routes_index_.Find(name);
+        if (index == nullptr) {
             return EMPTY_BUS_ROUTE;
         }
-        return *iter->second;
+        return bus_routes_[*index];
     }
 
     BusInfo TransportCatalogue::GetBusInfo(std::string_view bus_name) const {
+        const uint32_t* index = routes_index_.Find(bus_name);
+        if (index == nullptr) {
+            BusInfo result;
+            result.route_type = RouteType::NOT_SET;
+            return result;
+        }
+        return bus_infos_[*index];
+    }
+
+    BusInfo TransportCatalogue::ComputeBusInfo(const BusRoute& route) const {
         BusInfo result;
-        result.route_type = RouteType::NOT_SET;
-        auto iter = routes_index_.find(bus_name);
-        if (iter == routes_index_.end()) { return result; }
-        const BusRoute& route = *iter->second;
-        std::set<const Stop*> unique_stops(route.route_stops.begin(), route.route_stops.end());
-        result.unique_stops_counter = unique_stops.size();
+        std::vector<uint32_t> unique_stops;
+        unique_stops.reserve(route.route_stops.size());
+        for (const Stop* stop : route.route_stops) {
+            unique_stops.push_back(stop->id);
+        }
+        std::sort(unique_stops.begin(), unique_stops.end());
+        result.unique_stops_counter = std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
+        std::vector<double> latitudes;
+        std::vector<double> longitudes;
+        latitudes.reserve(route.route_stops.size());
+        longitudes.reserve(route.route_stops.size());
+        for (const Stop* stop : route.route_stops) {
+            latitudes.push_back(stop->coordinates.latitude);
+            longitudes.push_back(stop->coordinates.longitude);
+        }
+        std::vector<double> segment_lengths(route.route_stops.empty() ? 0 : route.route_stops.size() - 1);
+        geo::ComputeSegmentDistances(latitudes.data(), longitudes.data(), latitudes.size(), segment_lengths.data());
         double length_geo = 0.0;
+        for (const double segment_length : segment_lengths) {
+            length_geo += segment_length;
+        }
         size_t length_meters = 0;
         for(auto first = route.route_stops.begin(); first != route.route_stops.end(); ++first) {
             auto second = std::next(first);
             if (second == route.route_stops.end()) {
                 break;
             }
-            length_geo += ComputeDistance((**first).coordinates, (**second).coordinates);
-            length_meters += GetDistanceBetweenStops((**first).stop_name, (**second).stop_name);
+            length_meters += GetDistance((**first).id, (**second).id);
             if (route.type == RouteType::RETURN_ROUTE) {
-                length_meters += GetDistanceBetweenStops((**second).stop_name, (**first).stop_name);
+                length_meters += GetDistance((**second).id, (**first).id);
             }
         }
         result.stops_number = route.route_stops.size();
@@ -85,76 +217,165 @@ namespace transport{
         return result;
     }
 
-    const std::set<std::string_view>& TransportCatalogue::GetBusesForStop(std::string_view stop) const {
-        const auto it = stop_and_buses_.find(stop);
-        if (it == stop_and_buses_.end()) {
-            return EMPTY_BUS_ROUTE_SET;
+    std::vector<std::pair<const Stop*, double>> TransportCatalogue::FindNearestStops(geo::Coordinates point, size_t count) const {
+        if (!spatial_index_.IsBuilt()) {
+            throw std::logic_error("Stop spatial index is not built");
+        }
+        std::vector<std::pair<const Stop*, double>> result;
+        for (const auto& [stop_id, distance] : spatial_index_.FindNearest(point, count)) {
+            result.emplace_back(&stops_[stop_id - 1], distance);
+        }
+        return result;
+    }
+
+    std::vector<const Stop*> TransportCatalogue::FindStopsInBox(geo::Coordinates min, geo::Coordinates max) const {
+        if (!spatial_index_.IsBuilt()) {
+            throw std::logic_error("Stop spatial index is not built");
+        }
+        std::vector<const Stop*> result;
+        for (const StopId stop_id : spatial_index_.FindInBox(min, max)) {
+            result.push_back(&stops_[stop_id - 1]);
+        }
+        std::sort(result.begin(), result.end(), [](const Stop* lhs, const Stop* rhs) {
+            return lhs->stop_name < rhs->stop_name;
+        });
+        return result;
+    }
+
+    std::vector<RouteSegment> TransportCatalogue::FindRouteSegmentsInBox(geo::Coordinates min, geo::Coordinates max) const {
+        if (!segment_index_.IsBuilt()) {
+            throw std::logic_error("Route segment index is not built");
+        }
+        return segment_index_.FindInBox(min, max);
+    }
+
+    ranges::Range<const uint32_t*> TransportCatalogue::GetBusesForStop(std::string_view stop) const {
+        if (stop_bus_offsets_.empty()) {
+            throw std::logic_error("Stop bus index is not built");
+        }
+        const uint32_t* id = stops_index_.Find(stop);
+        if (id == nullptr) {
+            return {nullptr, nullptr};
+        }
+        return GetStopBuses(*id);
+    }
+
+    const std::vector<uint32_t>& TransportCatalogue::GetBusesByName() const {
+        if (route_orders_.size() != bus_routes_.size()) {
+            throw std::logic_error("Route order is not built");
+        }
+        return buses_by_name_;
+    }
+
+    uint32_t TransportCatalogue::GetRouteOrder(uint32_t bus_id) const {
+        if (route_orders_.size() != bus_routes_.size()) {
+            throw std::logic_error("Route order is not built");
+        }
+        return route_orders_.at(bus_id);
+    }
+
+    const BusRoute& TransportCatalogue::GetBusById(uint32_t bus_id) const {
+        if (bus_id >= bus_routes_.size()) {
+            return EMPTY_BUS_ROUTE;
+        }
+        return bus_routes_[bus_id];
+    }
+
+    std::string_view TransportCatalogue::GetBusNameById(uint32_t bus_id) const {
+        if (bus_id >= bus_routes_.size()) {
+            return {};
+        } return {bus_routes_[bus_id].bus_name};
+    }
+
+    void TransportCatalogue::StoreDistance(StopId stop_id, StopId other_stop_id, int distance, bool overwrite) {
+        auto& neighbors = stop_distances_[stop_id - 1];
+        const auto it = std::lower_bound(neighbors.begin(), neighbors.end(), other_stop_id,
+                                         [](const NeighborDistance& neighbor, StopId id) { return neighbor.stop_id < id; });
+        if (it == neighbors.end() || it->stop_id != other_stop_id) {
+            neighbors.insert(it, {other_stop_id, distance});
+        } else if (overwrite) {
+            it->distance = distance;
         }
-        return it->second;
     }
 
     bool TransportCatalogue::SetDistanceBetweenStops(std::string_view stop, std::string_view other_stop, int distance) {
-        auto it_stop = stops_index_.find(stop);
-        auto it_other = stops_index_.find(other_stop);
-        if (it_stop == stops_index_.end() || it_other == stops_index_.end()) {
+        const uint32_t* stop_id = stops_index_.Find(stop);
+        const uint32_t* other_id = stops_index_.Find(other_stop);
+        if (stop_id == nullptr || other_id == nullptr) {
             return false;
         }
-        StopsPointers direct {};
-        direct.stop = it_stop->second;
-        direct.other = it_other->second;
-        stops_distance_index_[direct] = distance;
-        StopsPointers reverse {};
-        reverse.stop = direct.other;
-        reverse.other = direct.stop;
-        auto it_rev = stops_distance_index_.find(reverse);
-        if (it_rev == stops_distance_index_.end()) {
-            stops_distance_index_[reverse] = distance;
-        }
+        StoreDistance(*stop_id, *other_id, distance, true);
+        StoreDistance(*other_id, *stop_id, distance, false);
+        UpdateBusInfos(*stop_id, *other_id);
         return true;
     }
 
+    // Пересчитываются только автобусы, проходящие через обе остановки: при потоковом чтении
+    // расстояния задаются до добавления автобусов, и пересечение обычно пустое
+    void TransportCatalogue::UpdateBusInfos(uint32_t stop_id, uint32_t other_stop_id) {
+        const auto buses = GetStopBuses(stop_id);
+        const auto other_buses = GetStopBuses(other_stop_id);
+        if (buses.empty() || other_buses.empty()) {
+            return;
+        }
+        for (const uint32_t bus_id : buses) {
+            if (std::find(other_buses.begin(), other_buses.end(), bus_id) != other_buses.end()) {
+                bus_infos_[bus_id] = ComputeBusInfo(bus_routes_[bus_id]);
+            }
+        }
+    }
+
     int TransportCatalogue::GetDistanceBetweenStops(std::string_view stop, std::string_view other_stop) const {
-        const auto it_stop = stops_index_.find(stop);
-        const auto it_other = stops_index_.find(other_stop);
-        if (it_stop == stops_index_.end() || it_other == stops_index_.end()) { return -1; }
-        StopsPointers direct {};
-        direct.stop = it_stop->second;
-        direct.other = it_other->second;
-        auto it_dist = stops_distance_index_.find(direct);
-        if (it_dist == stops_distance_index_.end()) { return -1; }
-        return it_dist->second;
+        return GetDistance(GetStopId(stop), GetStopId(other_stop));
+    }
+
+    int TransportCatalogue::GetDistance(StopId stop_id, StopId other_stop_id) const {
+        if (stop_id == 0 || stop_id > stop_distances_.size()) { return -1; }
+        const auto& neighbors = stop_distances_[stop_id - 1];
+        const auto it = std::lower_bound(neighbors.begin(), neighbors.end(), other_stop_id,
+                                         [](const NeighborDistance& neighbor, StopId id) { return neighbor.stop_id < id; });
+        if (it == neighbors.end() || it->stop_id != other_stop_id) { return -1; }
+        return it->distance;
     }
 
     std::map<std::string_view, const BusRoute*> TransportCatalogue::GetAllRoutesIndex() const {
-        std::map<std::string_view, const BusRoute*>  result(routes_index_.begin(), routes_index_.end());
+        std::map<std::string_view, const BusRoute*> result;
+        for (const BusRoute& route : bus_routes_) {
+            result.emplace(route.bus_name, &route);
+        }
         return result;
     }
 
     std::map<std::string_view, const Stop *> TransportCatalogue::GetAllStopsIndex() const {
-        std::map<std::string_view, const Stop*> result(stops_index_.begin(), stops_index_.end());
+        std::map<std::string_view, const Stop*> result;
+        for (const Stop& stop : stops_) {
+            result.emplace(stop.stop_name, &stop);
+        }
         return result;
     }
 
-    const std::unordered_map<std::string_view, const Stop *>& TransportCatalogue::RawStopsIndex() const {
-        return stops_index_;
+    const std::deque<Stop>& TransportCatalogue::GetStops() const {
+        return stops_;
     }
 
     void TransportCatalogue::SaveToSerializeTransportCat(tc_serialize::TransportCatalogue& t_cat) const {
         tc_serialize::StopsList st_list;
-        for (const auto [_, stop_ptr] : stop_id_name_index_ ) {
-            *st_list.add_all_stops() = std::move(SerializeStop(*stop_ptr));
+        for (const Stop& stop : stops_) {
+            *st_list.add_all_stops() = std::move(SerializeStop(stop));
         }
         *(t_cat.mutable_base_settings()->mutable_stops_list()) = std::move(st_list);
         tc_serialize::StopDistanceIndex stop_distances;
-        for (const auto [stop_ptrs, distance] : stops_distance_index_) {
-            *stop_distances.add_all_stops_distance_index() = std::move(
-                    SerializeDistance(stop_ptrs.stop->id, stop_ptrs.other->id, distance));
+        for (const Stop& stop : stops_) {
+            for (const auto& [other_id, distance] : stop_distances_[stop.id - 1]) {
+                *stop_distances.add_all_stops_distance_index() = std::move(SerializeDistance(stop.id, other_id, distance));
+            }
         }
         *(t_cat.mutable_base_settings()->mutable_stop_dist_index()) = std::move(stop_distances);
         tc_serialize::AllRoutesList routes_list;
-        for (const BusRoute& route : bus_routes_) {
+        for (size_t index = 0; index < bus_routes_.size(); ++index) {
+            const BusRoute& route = bus_routes_[index];
             tc_serialize::BusRoute br_out;
-            br_out.set_bus_name(route.bus_name);
+            br_out.set_bus_name(std::string{route.bus_name});
             int8_t route_type;
             if (route.type == RouteType::CIRCLE_ROUTE) { route_type = 1; }
             else if (route.type == RouteType::RETURN_ROUTE) { route_type = 2; }
@@ -163,23 +384,38 @@ namespace transport{
             for (auto stop_ptr : route.route_stops) {
                 br_out.add_stop_ids(stop_ptr->id);
             }
+            const BusInfo& bus_info = bus_infos_[index];
+            br_out.set_route_length(bus_info.route_length);
+            br_out.set_curvature(bus_info.curvature);
+            br_out.set_unique_stop_count(static_cast<uint32_t>(bus_info.unique_stops_counter));
             *routes_list.add_routes_list() = std::move(br_out);
         }
         *(t_cat.mutable_base_settings()->mutable_all_routes_list()) = std::move(routes_list);
+        for (const StopId stop_id : spatial_index_.GetOrder()) {
+            t_cat.mutable_base_settings()->add_spatial_index_order(stop_id);
+        }
     }
 
 
     bool TransportCatalogue::RestoreFromSerializedTransportCat(tc_serialize::TransportCatalogue& t_cat) {
-        tc_serialize::StopsList st_list = t_cat.base_settings().stops_list();
+        // id остановок в базе плотные, но старые базы могли записать их в произвольном порядке
+        std::vector<Stop> stops;
+        const tc_serialize::StopsList& st_list = t_cat.base_settings().stops_list();
+        stops.reserve(st_list.all_stops_size());
         for (int i = 0; i < st_list.all_stops_size(); ++i) {
-            AddStop(DeserializeStop(st_list.all_stops(i)));
+            stops.push_back(DeserializeStop(st_list.all_stops(i)));
         }
-        tc_serialize::StopDistanceIndex stops_distances = t_cat.base_settings().stop_dist_index();
+        std::sort(stops.begin(), stops.end(), [](const Stop& lhs, const Stop& rhs) { return lhs.id < rhs.id; });
+        for (const Stop& stop : stops) {
+            AddStop(stop);
+            if (stops_.back().id != stop.id) { return false; }
+        }
+        const tc_serialize::StopDistanceIndex& stops_distances = t_cat.base_settings().stop_dist_index();
+        // в базе записаны все направленные расстояния, включая достроенные обратные, поэтому они восстанавливаются как есть
         for (int i = 0; i < stops_distances.all_stops_distance_index_size(); ++i) {
             const auto& dist = stops_distances.all_stops_distance_index(i);
-            std::string_view from = GetStopNameById(dist.from_id());
-            std::string_view to = GetStopNameById(dist.to_id());
-            SetDistanceBetweenStops(from, to, dist.distance());
+            if (GetStopNameById(dist.from_id()).empty() || GetStopNameById(dist.to_id()).empty()) { return false; }
+            StoreDistance(dist.from_id(), dist.to_id(), dist.distance(), true);
         }
         tc_serialize::AllRoutesList all_routes = t_cat.base_settings().all_routes_list();
         for (int i = 0; i < all_routes.routes_list_size(); ++i) {
@@ -195,26 +431,45 @@ namespace transport{
             }
             bus_out.route_stops.reserve(route_in.stop_ids_size());
             for (int j = 0; j < route_in.stop_ids_size(); ++j) {
-                const std::string_view stop_name = GetStopNameById(route_in.stop_ids(j));
-                const auto [result, stop_const_ref] = FindStop(stop_name);
-                if (!result) { return false; }
-                bus_out.route_stops.emplace_back(&stop_const_ref);
+                const uint32_t stop_id = route_in.stop_ids(j);
+                if (stop_id == 0 || stop_id > stops_.size()) { return false; }
+                bus_out.route_stops.emplace_back(&stops_[stop_id - 1]);
+            }
+            if (routes_index_.Find(bus_out.bus_name) != nullptr) { continue; }
+            if (route_in.unique_stop_count() == 0) {
+                AddBusWithInfo(bus_out, ComputeBusInfo(bus_out));
+                continue;
             }
-            AddBus(bus_out);
-        } return true;
+            BusInfo bus_info;
+            bus_info.route_type = bus_out.type;
+            bus_info.stops_number = bus_out.type == RouteType::RETURN_ROUTE ? bus_out.route_stops.size() * 2 - 1
+                                                                            : bus_out.route_stops.size();
+            bus_info.unique_stops_counter = route_in.unique_stop_count();
+            bus_info.route_length = route_in.route_length();
+            bus_info.curvature = route_in.curvature();
+            AddBusWithInfo(bus_out, bus_info);
+        }
+        BuildStopBusIndex();
+        BuildRouteOrder();
+        // старые базы не содержат пространственного индекса, он строится заново
+        const auto& spatial_order = t_cat.base_settings().spatial_index_order();
+        if (!spatial_index_.Restore(stops_, {spatial_order.begin(), spatial_order.end()})) {
+            spatial_index_.Build(stops_);
+        }
+        segment_index_.Build(bus_routes_);
+        return true;
     }
 
     uint32_t TransportCatalogue::GetStopId(const std::string_view stop_name) const {
-        auto it = stops_index_.find(stop_name);
-        if (it == stops_index_.end()) {
+        const uint32_t* id = stops_index_.Find(stop_name);
+        if (id == nullptr) {
             return 0;
-        } return it->second->id;
+        } return *id;
     }
 
     std::string_view TransportCatalogue::GetStopNameById(uint32_t stop_id) const {
-        auto it = stop_id_name_index_.find(stop_id);
-        if (it == stop_id_name_index_.end()) {
+        if (stop_id == 0 || stop_id > stops_.size()) {
             return {};
-        } return {it->second->stop_name};
+        } return {stops_[stop_id - 1].stop_name};
     }
 } // namespace transport_catalogue
@@ -7,30 +7,35 @@
 #include <string>
 #include <vector>
 #include <optional>
-#include <unordered_map>
+#include <string_view>
 
+#include "flat_hash_map.h"
 #include "geo.h"
 #include "domain.h"
 #include "graph.h"
+#include "ranges.h"
+#include "string_arena.h"
 #include "serialization.h"
+#include "spatial_index.h"
 #include "transport_catalogue.pb.h"
 
 namespace transport {
 
-    struct StopsPointers {
-    public:
-        const Stop* stop;
-        const Stop* other;
-        size_t operator()(const StopsPointers& st_pair) const{
-            return hasher_(st_pair.stop) + 43*hasher_(st_pair.other);
-        }
-        bool operator()(const StopsPointers& lhs, const StopsPointers& rhs) const{
-            return lhs.stop == rhs.stop && lhs.other == rhs.other;
-        }
-    private:
-        std::hash<const Stop*> hasher_;
-    };
-
+    /*
+     * После заполнения справочник не меняется: константные методы только читают данные
+     * и могут вызываться из нескольких потоков одновременно.
+     *
+     * Остановкам и автобусам при добавлении выдаются плотные номера: id остановки равен её позиции в stops_ плюс один,
+     * номер автобуса - позиции в bus_routes_. Данные по остановкам хранятся в векторах по этим номерам
+     * (в том числе расстояния - отсортированным массивом соседей каждой остановки),
+     * хеш-таблицы нужны только для поиска номера по имени.
+     * Статистика маршрута (BusInfo) считается один раз при добавлении автобуса и пересчитывается,
+     * только если позже меняется расстояние между двумя его остановками.
+     * Имена хранятся один раз в StringArena справочника, остановки, маршруты и индексы ссылаются на них через string_view.
+     * После загрузки BuildIndexes собирает списки автобусов по остановкам в один массив (CSR)
+     * и строит пространственные индексы остановок и отрезков маршрутов; порядок индекса остановок сохраняется в базу,
+     * индекс отрезков строится заново при загрузке.
+     */
     class TransportCatalogue {
     public:
         TransportCatalogue() = default;
@@ -38,12 +43,33 @@ namespace transport {
         bool RestoreFromSerializedTransportCat(tc_serialize::TransportCatalogue& t_cat);
         bool SetDistanceBetweenStops(std::string_view stop, std::string_view other_stop, int distance);
         int GetDistanceBetweenStops(std::string_view stop, std::string_view other_stop) const;
+        // Расстояние по дороге между остановками по их id, -1 - расстояние не задано
+        int GetDistance(StopId stop_id, StopId other_stop_id) const;
         void AddStop(const std::string& name, geo::Coordinates coords);
         void AddStop(const Stop& stop);
         void SaveToSerializeTransportCat(tc_serialize::TransportCatalogue& t_cat) const;
-        const std::unordered_map<std::string_view, const Stop*>& RawStopsIndex() const;
+        // Остановки в порядке их id
+        const std::deque<Stop>& GetStops() const;
         const BusRoute& FindBus(std::string_view name) const;
-        const std::set<std::string_view>& GetBusesForStop(std::string_view stop) const;
+        // Строит индекс автобусов по остановкам и пространственные индексы остановок и отрезков маршрутов.
+        // Вызывается после загрузки, следующие AddBus и AddStop перестраивают соответствующий индекс
+        void BuildIndexes();
+        // Номера автобусов через остановку в порядке их имён, требует BuildIndexes
+        ranges::Range<const uint32_t*> GetBusesForStop(std::string_view stop) const;
+        // Не больше count ближайших к точке остановок с расстояниями в метрах, по возрастанию расстояния
+        std::vector<std::pair<const Stop*, double>> FindNearestStops(geo::Coordinates point, size_t count) const;
+        // Остановки внутри прямоугольника координат (включая границы) в порядке их имён
+        std::vector<const Stop*> FindStopsInBox(geo::Coordinates min, geo::Coordinates max) const;
+        // Отрезки маршрутов между соседними остановками, которые могут пересекать прямоугольник (пересекается
+        // прямоугольник, охватывающий отрезок), по возрастанию номера автобуса и позиции в route_stops
+        std::vector<RouteSegment> FindRouteSegmentsInBox(geo::Coordinates min, geo::Coordinates max) const;
+        // Номера автобусов в порядке их имён, требует BuildIndexes
+        const std::vector<uint32_t>& GetBusesByName() const;
+        // Номер автобуса среди автобусов с остановками в порядке имён, по нему карта выбирает цвет маршрута.
+        // Считается один раз в BuildIndexes, требует его
+        uint32_t GetRouteOrder(uint32_t bus_id) const;
+        const BusRoute& GetBusById(uint32_t bus_id) const;
+        std::string_view GetBusNameById(uint32_t bus_id) const;
         uint32_t GetStopId(std::string_view stop_name) const;
         BusInfo GetBusInfo(std::string_view bus_name) const;
         std::pair<bool, const Stop&> FindStop(std::string_view name) const;
@@ -51,13 +77,45 @@ namespace transport {
         std::map<std::string_view, const Stop*> GetAllStopsIndex() const;
         std::string_view GetStopNameById(uint32_t stop_id) const;
     private:
-        uint32_t stop_id_counter_ = 0;
+        struct NeighborDistance {
+            StopId stop_id;
+            int distance;
+        };
+
+        // Упаковывает списки автобусов по остановкам, отсортированные по имени автобуса, и освобождает stop_buses_
+        void BuildStopBusIndex();
+        // Вставляет автобус в уже упакованные списки его остановок
+        void AddBusToStopBusIndex(uint32_t bus_id);
+        // Автобусы остановки: до упаковки - в порядке добавления, после - по имени
+        ranges::Range<const uint32_t*> GetStopBuses(StopId stop_id) const;
+        // Заполняет buses_by_name_ и route_orders_
+        void BuildRouteOrder();
+        void StoreDistance(StopId stop_id, StopId other_stop_id, int distance, bool overwrite);
+        const Stop* FindStopPtr(std::string_view name) const;
+        void AddBusWithInfo(const BusRoute& bus_route, const BusInfo& bus_info);
+        BusInfo ComputeBusInfo(const BusRoute& route) const;
+        void UpdateBusInfos(uint32_t stop_id, uint32_t other_stop_id);
+
+        // имена остановок и автобусов, на которые указывают stops_, bus_routes_ и индексы
+        StringArena names_;
         std::deque<Stop> stops_;
         std::deque<BusRoute> bus_routes_;
-        std::unordered_map<std::string_view, const Stop*> stops_index_;
-        std::unordered_map<uint32_t, const Stop*> stop_id_name_index_;
-        std::unordered_map<std::string_view, const BusRoute*> routes_index_;
-        std::unordered_map<std::string_view, std::set<std::string_view>> stop_and_buses_;
-        std::unordered_map<StopsPointers, int, StopsPointers, StopsPointers> stops_distance_index_;
+        // статистика маршрутов по номеру автобуса
+        std::vector<BusInfo> bus_infos_;
+        flat_hash::FlatHashMap<std::string_view, uint32_t> stops_index_;
+        flat_hash::FlatHashMap<std::string_view, uint32_t> routes_index_;
+        // автобусы, проходящие через остановку, по номеру остановки (id - 1), в порядке добавления.
+        // Нужны только при загрузке: BuildStopBusIndex упаковывает их в stop_bus_ids_ и освобождает
+        std::vector<std::vector<uint32_t>> stop_buses_;
+        // упакованные списки: автобусы остановки с id лежат в stop_bus_ids_[stop_bus_offsets_[id - 1], stop_bus_offsets_[id])
+        std::vector<uint32_t> stop_bus_offsets_;
+        std::vector<uint32_t> stop_bus_ids_;
+        // автобусы по имени и порядковые номера маршрутов для карты по номеру автобуса
+        std::vector<uint32_t> buses_by_name_;
+        std::vector<uint32_t> route_orders_;
+        // расстояния от остановки (по id - 1) до соседних, отсортированы по id соседа
+        std::vector<std::vector<NeighborDistance>> stop_distances_;
+        StopSpatialIndex spatial_index_;
+        RouteSegmentIndex segment_index_;
     };
 } // namespace transport_catalogue
@@ -1,21 +1,32 @@
 #include "transport_router.h"
 
 TransportCatalogueRouterGraph::TransportCatalogueRouterGraph(const transport::TransportCatalogue& tc, RoutingSettings rs):
-        graph::DirectedWeightedGraph<double>(tc.RawStopsIndex().size()), tc_(tc), rs_(rs) {
+        graph::DirectedWeightedGraph<double>(tc.GetStops().size()), tc_(tc), rs_(rs) {
 
     const auto& routes_index = tc_.GetAllRoutesIndex();
-    for (const auto& [stop_name, stop_ptr] : tc_.RawStopsIndex()) {
-        StopOnRoute stop {0, stop_name, {}};
-        RegisterStop(stop);
+    // вершины остановок регистрируются первыми в порядке id, см. GetBuildStopVertexId
+    for (const transport::Stop& stop : tc_.GetStops()) {
+        RegisterStop(StopOnRoute{0, stop.stop_name, {}});
     }
-    for (const auto& [_, bus_route] : routes_index) {
-        if (bus_route->type == transport::RouteType::RETURN_ROUTE) {
-            FillWithReturnRouteStops(bus_route);
-        } else {
-            FillWithCircleRouteStops(bus_route);
+    if (rs_.graph_model == GraphModel::RIDE_VERTICES) {
+        for (const auto& [_, bus_route] : routes_index) {
+            RegisterRideVertices(bus_route);
+        }
+        vertex_count_ = vertex_id_count_;
+        for (const auto& [_, bus_route] : routes_index) {
+            FillWithRideEdges(bus_route);
+        }
+    } else {
+        for (const auto& [_, bus_route] : routes_index) {
+            if (bus_route->type == transport::RouteType::RETURN_ROUTE) {
+                FillWithReturnRouteStops(bus_route);
+            } else {
+                FillWithCircleRouteStops(bus_route);
+            }
         }
     }
-    router_ptr_ = std::make_unique<graph::Router<double>>(*this);
+    FreezeGraph();
+    router_ptr_ = std::make_unique<graph::Router<double>>(*this, rs_.router_type);
 }
 
 void TransportCatalogueRouterGraph::FillWithReturnRouteStops(const transport::BusRoute *bus_route) {
@@ -24,17 +35,17 @@ void TransportCatalogueRouterGraph::FillWithReturnRouteStops(const transport::Bu
         int accumulated_distance_direct = 0;
         int accumulated_distance_reverse = 0;
         const auto wait_time_at_stop = static_cast<double>(rs_.bus_wait_time);
-        auto from_id = GetStopVertexId((*start)->stop_name);
+        auto from_id = GetBuildStopVertexId(*start);
         for (auto first = start, second = start + 1; second != bus_route->route_stops.end(); ++first, ++second) {
-            auto to_id = GetStopVertexId((*second)->stop_name);
+            auto to_id = GetBuildStopVertexId(*second);
             TwoStopsLink direct_link(bus_route->bus_name, from_id, to_id, stop_distance);
-            const int direct_distance = tc_.GetDistanceBetweenStops((*first)->stop_name, (*second)->stop_name);
+            const int direct_distance = tc_.GetDistance((*first)->id, (*second)->id);
             accumulated_distance_direct += direct_distance;
             const double direct_link_time = wait_time_at_stop + CalculateTimeForDistance(accumulated_distance_direct); // travel time between 2 stops
             const auto direct_edge_id = AddEdge({from_id, to_id, direct_link_time});
             StoreLink(direct_link, direct_edge_id);
             TwoStopsLink reverse_link(bus_route->bus_name, to_id, from_id, stop_distance);
-            const int reverse_distance = tc_.GetDistanceBetweenStops((*second)->stop_name, (*first)->stop_name);
+            const int reverse_distance = tc_.GetDistance((*second)->id, (*first)->id);
             accumulated_distance_reverse += reverse_distance;
             const double reverse_link_time = wait_time_at_stop + CalculateTimeForDistance(accumulated_distance_reverse); // travel time between 2 stops
             const auto reverse_edge_id = AddEdge({to_id, from_id, reverse_link_time});
@@ -50,11 +61,11 @@ void TransportCatalogueRouterGraph::FillWithCircleRouteStops(const transport::Bu
         size_t stop_distance = 1;
         int accumulated_distance_direct = 0;
         const auto wait_time_at_stop = static_cast<double>(rs_.bus_wait_time);
-        auto from_id = GetStopVertexId((*start)->stop_name);
+        auto from_id = GetBuildStopVertexId(*start);
         for (auto first = start, second = start + 1; second != bus_route->route_stops.end(); ++first, ++second) {
-            auto to_id = GetStopVertexId((*second)->stop_name);
+            auto to_id = GetBuildStopVertexId(*second);
             TwoStopsLink direct_link(bus_route->bus_name, from_id, to_id, stop_distance);
-            const int direct_distance = tc_.GetDistanceBetweenStops((*first)->stop_name, (*second)->stop_name);
+            const int direct_distance = tc_.GetDistance((*first)->id, (*second)->id);
             accumulated_distance_direct += direct_distance;
             const double direct_link_time = wait_time_at_stop + CalculateTimeForDistance(accumulated_distance_direct); // travel time between 2 stops
             const auto direct_edge_id = AddEdge({from_id, to_id, direct_link_time});
@@ -65,6 +76,65 @@ void TransportCatalogueRouterGraph::FillWithCircleRouteStops(const transport::Bu
     }
 }
 
+// Вершины поездки нумеруются позицией остановки в проходе автобуса: для кольцевого маршрута 0..n-1,
+// для маршрута туда-обратно 0..n-1 в прямом направлении и n..2n-1 в обратном
+void TransportCatalogueRouterGraph::RegisterRideVertices(const transport::BusRoute* bus_route) {
+    const auto& stops = bus_route->route_stops;
+    for (size_t position = 0; position < stops.size(); ++position) {
+        RegisterStop(StopOnRoute{position, stops[position]->stop_name, bus_route->bus_name});
+    }
+    if (bus_route->type == transport::RouteType::RETURN_ROUTE) {
+        for (size_t position = 0; position < stops.size(); ++position) {
+            RegisterStop(StopOnRoute{stops.size() + position, stops[stops.size() - 1 - position]->stop_name, bus_route->bus_name});
+        }
+    }
+}
+
+void TransportCatalogueRouterGraph::FillWithRideEdges(const transport::BusRoute* bus_route) {
+    const auto& stops = bus_route->route_stops;
+    FillRideChain(bus_route->bus_name, stops.begin(), stops.end(), 0);
+    if (bus_route->type == transport::RouteType::RETURN_ROUTE) {
+        FillRideChain(bus_route->bus_name, stops.rbegin(), stops.rend(), stops.size());
+    }
+}
+
+template <typename StopIt>
+void TransportCatalogueRouterGraph::FillRideChain(std::string_view bus_name, StopIt begin, StopIt end, size_t first_position) {
+    const auto wait_time_at_stop = static_cast<double>(rs_.bus_wait_time);
+    size_t position = first_position;
+    std::optional<graph::VertexId> prev_ride_id;
+    for (auto current = begin; current != end; ++current, ++position) {
+        const auto stop_id = GetBuildStopVertexId(*current);
+        const auto ride_id = stop_to_vertex_.at(StopOnRoute{position, (*current)->stop_name, bus_name});
+        if (std::next(current) != end) {
+            edge_count_ = AddEdge({stop_id, ride_id, wait_time_at_stop}); // посадка
+        }
+        if (prev_ride_id) {
+            const int distance = tc_.GetDistance((*std::prev(current))->id, (*current)->id);
+            AddEdge({*prev_ride_id, ride_id, CalculateTimeForDistance(distance)}); // перегон
+            edge_count_ = AddEdge({ride_id, stop_id, 0.0}); // высадка
+        }
+        prev_ride_id = ride_id;
+    }
+}
+
+void TransportCatalogueRouterGraph::FreezeGraph() {
+    // после упаковки в CSR идентификаторы рёбер меняются, переносим на них связи между остановками
+    const auto new_ids = Freeze();
+    std::unordered_map<graph::EdgeId, TwoStopsLink> edge_to_stoplink;
+    edge_to_stoplink.reserve(edge_to_stoplink_.size());
+    for (const auto& [edge, stoplink] : edge_to_stoplink_) {
+        edge_to_stoplink[new_ids.at(edge)] = stoplink;
+    }
+    for (auto& [_, edge] : stoplink_to_edge_) {
+        edge = new_ids.at(edge);
+    }
+    edge_to_stoplink_ = std::move(edge_to_stoplink);
+    if (!new_ids.empty()) {
+        edge_count_ = new_ids.at(edge_count_);
+    }
+}
+
 graph::VertexId TransportCatalogueRouterGraph::RegisterStop(const StopOnRoute& stop) {
     auto iter = stop_to_vertex_.find(stop);
     if (iter != stop_to_vertex_.end()) {
@@ -91,7 +161,22 @@ double TransportCatalogueRouterGraph::CalculateTimeForDistance(int distance) con
     return static_cast<double>(distance) / (rs_.bus_velocity * (1000.00 / 60.00));
 }
 
+double TransportCatalogueRouterGraph::CalculateWalkTime(double distance) const {
+    return distance / (rs_.pedestrian_velocity * (1000.00 / 60.00));
+}
+
+graph::VertexId TransportCatalogueRouterGraph::GetBuildStopVertexId(const transport::Stop* stop) {
+    return stop->id - 1;
+}
+
 graph::VertexId TransportCatalogueRouterGraph::GetStopVertexId(std::string_view stop_name) const {
+    if (mapped_file_) {
+        const uint32_t stop_id = tc_.GetStopId(stop_name);
+        if (stop_id < mapped_stop_count_ && mapped_stop_vertices_[stop_id] != mapped_base::NO_ID) {
+            return mapped_stop_vertices_[stop_id];
+        }
+        throw std::logic_error("Error, no stop named: " + std::string(stop_name));
+    }
     StopOnRoute stop{0, stop_name, {}};
     auto iter = stop_to_vertex_.find(stop);
     if (iter != stop_to_vertex_.end()) {
@@ -100,7 +185,14 @@ graph::VertexId TransportCatalogueRouterGraph::GetStopVertexId(std::string_view
     throw std::logic_error("Error, no stop named: " + std::string(stop_name));
 }
 
-const TransportCatalogueRouterGraph::StopOnRoute& TransportCatalogueRouterGraph::GetStopById(graph::VertexId id) const {
+TransportCatalogueRouterGraph::StopOnRoute TransportCatalogueRouterGraph::GetStopById(graph::VertexId id) const {
+    if (mapped_file_) {
+        if (id >= GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const auto& vertex = mapped_vertices_[id];
+        return StopOnRoute{vertex.stop_number, tc_.GetStopNameById(vertex.stop_id), mapped_file_->GetName(vertex.bus_name)};
+    }
     return vertex_to_stop_.at(id);
 }
 
@@ -108,7 +200,11 @@ double TransportCatalogueRouterGraph::GetBusWaitingTime() const {
     return static_cast<double>(rs_.bus_wait_time);
 }
 
-const TwoStopsLink& TransportCatalogueRouterGraph::GetLinkById(graph::EdgeId id) const {
+TwoStopsLink TransportCatalogueRouterGraph::GetLinkById(graph::EdgeId id) const {
+    if (mapped_links_ && id < GetEdgeCount()) {
+        const auto& link = mapped_links_[id];
+        return TwoStopsLink{mapped_file_->GetName(link.bus_name), link.stop_from, link.stop_to, link.number_of_stops};
+    }
     auto iter = edge_to_stoplink_.find(id);
     if (iter != edge_to_stoplink_.end()) {
         return iter->second;
@@ -123,10 +219,177 @@ std::optional<graph::Router<double>::RouteInfo> TransportCatalogueRouterGraph::B
     return router_ptr_->BuildRoute(from_id, to_id);
 }
 
+PointRoute TransportCatalogueRouterGraph::BuildRouteFromPoint(geo::Coordinates from, geo::Coordinates to) const {
+    const double direct_distance = geo::ComputeDistanceHaversine(from, to);
+    PointRoute result;
+    result.first_walk = {{}, {}, direct_distance, CalculateWalkTime(direct_distance)};
+    result.total_time = result.first_walk.time;
+    if (!router_ptr_) return result;
+    const auto from_stops = tc_.FindNearestStops(from, static_cast<size_t>(rs_.walk_stop_count));
+    const auto to_stops = tc_.FindNearestStops(to, static_cast<size_t>(rs_.walk_stop_count));
+    auto make_endpoints = [this](const std::vector<std::pair<const transport::Stop*, double>>& stops) {
+        std::vector<graph::RouteEndpoint<double>> endpoints;
+        endpoints.reserve(stops.size());
+        for (const auto& [stop, distance] : stops) {
+            endpoints.push_back({GetStopVertexId(stop->stop_name), CalculateWalkTime(distance)});
+        }
+        return endpoints;
+    };
+    auto route = router_ptr_->BuildRoute(make_endpoints(from_stops), make_endpoints(to_stops));
+    if (!route || !(route->route.weight < result.total_time)) return result;
+    const auto& [first_stop, first_distance] = from_stops[route->from_index];
+    const auto& [last_stop, last_distance] = to_stops[route->to_index];
+    result.total_time = route->route.weight;
+    result.first_walk = {{}, first_stop->stop_name, first_distance, CalculateWalkTime(first_distance)};
+    result.last_walk = WalkLeg{last_stop->stop_name, {}, last_distance, CalculateWalkTime(last_distance)};
+    route->route.weight -= result.first_walk.time + result.last_walk->time;
+    result.ride = std::move(route->route);
+    return result;
+}
+
+std::vector<std::optional<double>> TransportCatalogueRouterGraph::BuildTimeMatrix(const std::vector<std::string_view>& from,
+                                                                                  const std::vector<std::string_view>& to) const {
+    if (!router_ptr_) return std::vector<std::optional<double>>(from.size() * to.size());
+    auto to_vertices = [this](const std::vector<std::string_view>& stops) {
+        std::vector<graph::VertexId> vertices;
+        vertices.reserve(stops.size());
+        for (const std::string_view stop : stops) {
+            vertices.push_back(GetStopVertexId(stop));
+        }
+        return vertices;
+    };
+    return router_ptr_->BuildWeightMatrix(to_vertices(from), to_vertices(to));
+}
+
+// Сворачивает рёбра маршрута в участки "ожидание + поездка" независимо от способа построения графа
+std::vector<RouteLeg> TransportCatalogueRouterGraph::GetRouteLegs(const graph::Router<double>::RouteInfo& route) const {
+    std::vector<RouteLeg> legs;
+    for (const auto edge_id : route.edges) {
+        const auto& edge = GetEdge(edge_id);
+        const auto& stop_from = GetStopById(edge.from);
+        if (rs_.graph_model == GraphModel::STOP_PAIRS) {
+            const auto& link = GetLinkById(edge_id);
+            legs.push_back({stop_from.stop_name, link.bus_name, static_cast<int>(link.number_of_stops),
+                            edge.weight - GetBusWaitingTime()});
+            continue;
+        }
+        const auto& stop_to = GetStopById(edge.to);
+        if (stop_from.bus_name.empty()) {
+            legs.push_back({stop_from.stop_name, stop_to.bus_name, 0, 0.0});
+        } else if (!stop_to.bus_name.empty()) {
+            ++legs.back().span_count;
+            legs.back().time += edge.weight;
+        }
+    }
+    return legs;
+}
+
 TransportCatalogueRouterGraph::TransportCatalogueRouterGraph(const transport::TransportCatalogue &tc, RoutingSettings rs,
                                                              const tc_serialize::TransportCatalogue &tc_) : tc_(tc), rs_(rs) {
     RestoreFrom(tc_);
-    router_ptr_ = std::make_unique<graph::Router<double>>(*this, tc_);
+}
+
+TransportCatalogueRouterGraph::TransportCatalogueRouterGraph(const transport::TransportCatalogue &tc, RoutingSettings rs,
+                                                             const tc_serialize::TransportCatalogue &tc_,
+                                                             const std::string& router_file) : tc_(tc), rs_(rs) {
+    mapped_file_ = std::make_unique<mapped_base::MappedFile>(router_file);
+    const auto& header = mapped_file_->GetHeader();
+    // размеры графа берутся из базы: файл от другой базы не подойдёт к ним, даже если сам он цел.
+    // В базах, записанных до появления этой проверки, размеров нет, и они берутся из файла
+    size_t vertex_count = header.vertex_count;
+    size_t edge_count = header.edges.count;
+    if (tc_.router_settings().has_tc_graph_router()) {
+        vertex_count = tc_.router_settings().tc_graph_router().vertex_id_count();
+        edge_count = tc_.router_settings().tc_graph_router().edge_count();
+    }
+    if (header.vertex_count != vertex_count) {
+        throw std::runtime_error("Router file doesn't match the base: wrong vertex count");
+    }
+    // всё, по чему запросы индексируют массивы, проверяется при загрузке, чтобы повреждённый файл
+    // отклонялся здесь, а не читался за пределами секций на первом запросе
+    const graph::EdgeId* offsets = mapped_file_->GetSection<graph::EdgeId>(header.offsets, vertex_count + 1);
+    if (offsets[0] != 0 || offsets[vertex_count] != edge_count) {
+        throw std::runtime_error("Corrupted router file: offsets don't match edges");
+    }
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        if (offsets[vertex] > offsets[vertex + 1]) {
+            throw std::runtime_error("Corrupted router file: offsets are not sorted");
+        }
+    }
+    const auto* edges = mapped_file_->GetSection<graph::Edge<double>>(header.edges, edge_count);
+    for (size_t edge = 0; edge < edge_count; ++edge) {
+        if (edges[edge].from >= vertex_count || edges[edge].to >= vertex_count) {
+            throw std::runtime_error("Corrupted router file: edge vertex is out of range");
+        }
+    }
+    AttachFrozen(vertex_count, edges, edge_count, offsets);
+    vertex_id_count_ = vertex_count;
+    mapped_stop_count_ = tc.GetStops().size() + 1;
+    mapped_vertices_ = mapped_file_->GetSection<mapped_base::VertexRecord>(header.vertices, vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        if (mapped_vertices_[vertex].stop_id == 0 || mapped_vertices_[vertex].stop_id >= mapped_stop_count_) {
+            throw std::runtime_error("Corrupted router file: vertex stop is out of range");
+        }
+    }
+    if (header.links.count != 0) {
+        mapped_links_ = mapped_file_->GetSection<mapped_base::LinkRecord>(header.links, edge_count);
+    }
+    mapped_stop_vertices_ = mapped_file_->GetSection<graph::VertexId>(header.stop_vertices, mapped_stop_count_);
+    for (size_t stop_id = 0; stop_id < mapped_stop_count_; ++stop_id) {
+        if (mapped_stop_vertices_[stop_id] != mapped_base::NO_ID && mapped_stop_vertices_[stop_id] >= vertex_count) {
+            throw std::runtime_error("Corrupted router file: stop vertex is out of range");
+        }
+    }
+    // матрица all_pairs обязательна: без неё маршрутизатор остался бы пустым
+    const graph::Router<double>::RouteCell* mapped_routes = nullptr;
+    if (rs_.router_type == graph::RouterType::ALL_PAIRS) {
+        mapped_routes = mapped_file_->GetSection<graph::Router<double>::RouteCell>(header.routes, vertex_count * vertex_count);
+    }
+    router_ptr_ = std::make_unique<graph::Router<double>>(*this, tc_, mapped_routes);
+}
+
+// В базу protobuf попадают только настройки и иерархия сжатия, остальное - в плоский router_file
+bool TransportCatalogueRouterGraph::SaveToMapped(tc_serialize::TransportCatalogue& tc_out, const std::string& router_file) const {
+    mapped_base::Writer writer;
+    mapped_base::Header header;
+    const size_t vertex_count = GetVertexCount();
+    header.vertex_count = vertex_count;
+    header.offsets = writer.Append(frozen_offsets_, vertex_count + 1);
+    header.edges = writer.Append(frozen_edges_, GetEdgeCount());
+    std::vector<mapped_base::VertexRecord> vertices;
+    vertices.reserve(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        const auto& stop = vertex_to_stop_.at(vertex);
+        vertices.push_back({tc_.GetStopId(stop.stop_name), static_cast<uint32_t>(stop.stop_number),
+                            stop.bus_name.empty() ? mapped_base::NameRef{} : writer.AddName(stop.bus_name)});
+    }
+    header.vertices = writer.Append(vertices.data(), vertices.size());
+    if (rs_.graph_model == GraphModel::STOP_PAIRS) {
+        std::vector<mapped_base::LinkRecord> links;
+        links.reserve(GetEdgeCount());
+        for (graph::EdgeId edge = 0; edge < GetEdgeCount(); ++edge) {
+            const auto& link = edge_to_stoplink_.at(edge);
+            links.push_back({writer.AddName(link.bus_name), link.stop_from, link.stop_to,
+                             static_cast<uint32_t>(link.number_of_stops)});
+        }
+        header.links = writer.Append(links.data(), links.size());
+    }
+    std::vector<graph::VertexId> stop_vertices(tc_.GetStops().size() + 1, mapped_base::NO_ID);
+    for (const transport::Stop& stop : tc_.GetStops()) {
+        stop_vertices[stop.id] = GetStopVertexId(stop.stop_name);
+    }
+    header.stop_vertices = writer.Append(stop_vertices.data(), stop_vertices.size());
+    if (router_ptr_->GetType() == graph::RouterType::ALL_PAIRS) {
+        const auto routes = router_ptr_->ExportRouteCells();
+        header.routes = writer.Append(routes.data(), routes.size());
+    }
+    writer.Save(router_file, header);
+    tc_out.mutable_router_settings()->set_router_file(router_file);
+    // по размерам графа при загрузке проверяется, что router_file записан вместе с этой базой
+    tc_out.mutable_router_settings()->mutable_tc_graph_router()->set_vertex_id_count(vertex_count);
+    tc_out.mutable_router_settings()->mutable_tc_graph_router()->set_edge_count(GetEdgeCount());
+    router_ptr_->SaveTo(tc_out, false);
+    return true;
 }
 
 bool TransportCatalogueRouterGraph::SaveTo(tc_serialize::TransportCatalogue& tc_out) const {
@@ -134,7 +397,7 @@ bool TransportCatalogueRouterGraph::SaveTo(tc_serialize::TransportCatalogue& tc_
     for (const auto& [stop, vertex] : stop_to_vertex_) {
         *out.add_tc_router_stops_() = std::move(SerializeStopOnRoute(stop, vertex));
     }
-    for (const auto& [stoplink, edge] : stoplink_to_edge_) {
+    for (const auto& [edge, stoplink] : edge_to_stoplink_) {
         *out.add_tc_router_links() = std::move(SerializeTwoStopsLink(stoplink, edge));
     }
     out.set_vertex_id_count(vertex_id_count_);
@@ -144,11 +407,6 @@ bool TransportCatalogueRouterGraph::SaveTo(tc_serialize::TransportCatalogue& tc_
         *edges_list.add_edges() = std::move(SerializeEdge(edge));
     }
     *out.mutable_graph_edges() = std::move(edges_list);
-    tc_serialize::IncidenceListPB big_list;
-    for (const auto& list : incidence_lists_) {
-        *big_list.add_lists() = std::move(SerializeIncList(list));
-    }
-    *out.mutable_graph_incidence_list() = std::move(big_list);
     *(tc_out.mutable_router_settings()->mutable_tc_graph_router()) = std::move(out);
     router_ptr_->SaveTo(tc_out);
     return true;
@@ -169,17 +427,25 @@ bool TransportCatalogueRouterGraph::RestoreFrom(const tc_serialize::TransportCat
         edge_to_stoplink_[edge_id] = link;
     }
     vertex_id_count_ = data_from.vertex_id_count();
+    vertex_count_ = vertex_id_count_;
     edge_count_ = data_from.edge_count();
     edges_.reserve(data_from.graph_edges().edges_size());
     for (int i = 0; i < data_from.graph_edges().edges_size(); ++i) {
         graph::Edge<double> edge = DeserializeEdge(data_from.graph_edges().edges(i));
         edges_.emplace_back(edge);
     }
-    incidence_lists_.reserve(data_from.graph_incidence_list().lists_size());
-    for (int i = 0; i < data_from.graph_incidence_list().lists_size(); ++i) {
-        auto list = std::move(DeserializeIncList(data_from.graph_incidence_list().lists(i)));
-        incidence_lists_.emplace_back(std::move(list));
+    // новые базы хранят рёбра в порядке CSR, и Freeze() только восстанавливает смещения. В базах старого формата
+    // рёбра записаны в порядке добавления: Freeze() их перенумеровывает, и сохранённые номера переводятся в новые
+    const std::vector<graph::EdgeId> new_ids = Freeze();
+    std::unordered_map<graph::EdgeId, TwoStopsLink> edge_to_stoplink;
+    edge_to_stoplink.reserve(edge_to_stoplink_.size());
+    for (const auto& [edge_id, link] : edge_to_stoplink_) {
+        const graph::EdgeId new_id = new_ids.at(edge_id);
+        edge_to_stoplink.emplace(new_id, link);
+        stoplink_to_edge_[link] = new_id;
     }
+    edge_to_stoplink_ = std::move(edge_to_stoplink);
+    router_ptr_ = std::make_unique<graph::Router<double>>(*this, tc_in, new_ids);
     return true;
 }
 
@@ -197,7 +463,10 @@ TransportCatalogueRouterGraph::StopOnRoute TransportCatalogueRouterGraph::Deseri
     auto st_name = tc_.GetStopNameById(stop.stop_id());
     const auto& [found, st_ref] = tc_.FindStop(st_name);
     result.stop_name = st_ref.stop_name;
-    result.bus_name = stop.bus_name();
+    // название берётся из справочника, а не из сообщения protobuf, которое живёт только во время загрузки
+    if (!stop.bus_name().empty()) {
+        result.bus_name = tc_.FindBus(stop.bus_name()).bus_name;
+    }
     result.stop_number = stop.stop_number();
     return result;
 }
@@ -235,19 +504,3 @@ graph::Edge<double> TransportCatalogueRouterGraph::DeserializeEdge(const tc_seri
     graph::Edge<double> result(edge.from(),edge.to(),edge.weight());
     return result;
 }
-
-tc_serialize::IncListPB TransportCatalogueRouterGraph::SerializeIncList(const std::vector<size_t>& list) {
-    tc_serialize::IncListPB result;
-    for (const size_t edge : list) {
-        result.add_list(edge);
-    }
-    return std::move(result);
-}
-
-std::vector<size_t> TransportCatalogueRouterGraph::DeserializeIncList(const tc_serialize::IncListPB& list) {
-    std::vector<size_t> result(list.list_size());
-    for (int i = 0; i < list.list_size(); ++i) {
-        result[i] = list.list(i);
-    }
-    return std::move(result);
-}
\ No newline at end of file
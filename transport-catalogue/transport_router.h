@@ -2,16 +2,64 @@
 #include "transport_catalogue.h"
 #include "transport_catalogue.pb.h"
 #include "router.h"
+#include "mapped_base.h"
 #include <memory>
 
 /*"routing_settings": {
             "bus_wait_time": 6,
-            bus_velocity": 40
+            bus_velocity": 40,
+            "router_type": "all_pairs" | "bidirectional_dijkstra" | "contraction_hierarchies",
+            "graph_model": "stop_pairs" | "ride_vertices",
+            "pedestrian_velocity": 5,
+            "walk_stop_count": 5
             } */
 
+/*
+ * Способ построения графа маршрутов:
+ * STOP_PAIRS - вершина на каждую остановку, ребро от каждой остановки маршрута до каждой следующей
+ * (ожидание + поездка), число рёбер квадратично от длины маршрута;
+ * RIDE_VERTICES - дополнительно вершина на каждую позицию остановки в маршруте автобуса,
+ * рёбра посадки (ожидание), перегона между соседними остановками и высадки (нулевой вес),
+ * число рёбер линейно от длины маршрута.
+ */
+enum class GraphModel {
+    STOP_PAIRS,
+    RIDE_VERTICES
+};
+
 struct RoutingSettings {
     int bus_wait_time;
     double bus_velocity;
+    graph::RouterType router_type = graph::RouterType::ALL_PAIRS;
+    GraphModel graph_model = GraphModel::STOP_PAIRS;
+    // скорость пешехода, км/ч, и число ближайших остановок, до которых ищется пеший путь от произвольной точки
+    double pedestrian_velocity = 5.0;
+    int walk_stop_count = 5;
+};
+
+// Участок маршрута: ожидание на остановке stop_name и поездка на автобусе bus_name через span_count перегонов
+struct RouteLeg {
+    std::string_view stop_name;
+    std::string_view bus_name;
+    int span_count = 0;
+    double time = 0.0;
+};
+
+// Пеший участок маршрута между точкой запроса и остановкой; пустое имя - сама точка запроса
+struct WalkLeg {
+    std::string_view from_stop;
+    std::string_view to_stop;
+    double distance = 0.0;
+    double time = 0.0;
+};
+
+// Маршрут между произвольными точками: пешком до остановки, на автобусах, пешком от остановки до точки назначения.
+// Если весь путь быстрее пройти пешком, ride и last_walk пусты, а first_walk ведёт сразу в точку назначения
+struct PointRoute {
+    double total_time = 0.0;
+    WalkLeg first_walk;
+    std::optional<graph::Router<double>::RouteInfo> ride;
+    std::optional<WalkLeg> last_walk;
 };
 
 struct TwoStopsLink {
@@ -38,6 +86,11 @@ private:
     std::hash<std::string_view> hasher_;
 };
 
+/*
+ * Граф и маршрутизатор строятся в конструкторе, после этого константные методы (BuildRoute, GetRouteLegs,
+ * GetStopById, GetLinkById) только читают данные и безопасны для одновременного вызова из нескольких потоков:
+ * все структуры поиска маршрута локальны для запроса.
+ */
 class TransportCatalogueRouterGraph : public graph::DirectedWeightedGraph<double> {
 public:
     struct StopOnRoute {
@@ -61,12 +114,22 @@ public:
     };
     TransportCatalogueRouterGraph(const transport::TransportCatalogue& tc, RoutingSettings rs);
     TransportCatalogueRouterGraph(const transport::TransportCatalogue& tc, RoutingSettings rs, const tc_serialize::TransportCatalogue& tc_);
+    // граф, вершины, связи и матрица маршрутов читаются на месте из отображённого в память router_file
+    TransportCatalogueRouterGraph(const transport::TransportCatalogue& tc, RoutingSettings rs, const tc_serialize::TransportCatalogue& tc_,
+                                  const std::string& router_file);
     ~TransportCatalogueRouterGraph() = default;
     bool SaveTo(tc_serialize::TransportCatalogue& tc_to) const;
+    bool SaveToMapped(tc_serialize::TransportCatalogue& tc_to, const std::string& router_file) const;
     bool RestoreFrom(const tc_serialize::TransportCatalogue& tc_from);
     std::optional<graph::Router<double>::RouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
-    const StopOnRoute& GetStopById(graph::VertexId id) const;
-    const TwoStopsLink& GetLinkById(graph::EdgeId id) const;
+    // Пеший путь до ближайших остановок подключается к поиску как виртуальные вершины, граф при этом не меняется
+    PointRoute BuildRouteFromPoint(geo::Coordinates from, geo::Coordinates to) const;
+    // Время в пути между всеми парами остановок from[i] -> to[j] по строкам, пусто - маршрута нет
+    std::vector<std::optional<double>> BuildTimeMatrix(const std::vector<std::string_view>& from,
+                                                       const std::vector<std::string_view>& to) const;
+    std::vector<RouteLeg> GetRouteLegs(const graph::Router<double>::RouteInfo& route) const;
+    StopOnRoute GetStopById(graph::VertexId id) const;
+    TwoStopsLink GetLinkById(graph::EdgeId id) const;
     double GetBusWaitingTime() const;
 private:
     const transport::TransportCatalogue& tc_;
@@ -78,18 +141,29 @@ private:
     graph::VertexId vertex_id_count_ = 0;
     std::unordered_map<TwoStopsLink, graph::EdgeId, TwoStopsLink, TwoStopsLink> stoplink_to_edge_;
     std::unordered_map<graph::EdgeId, TwoStopsLink> edge_to_stoplink_;
+    std::unique_ptr<mapped_base::MappedFile> mapped_file_;
+    const mapped_base::VertexRecord* mapped_vertices_ = nullptr;
+    const mapped_base::LinkRecord* mapped_links_ = nullptr;
+    const graph::VertexId* mapped_stop_vertices_ = nullptr;
+    size_t mapped_stop_count_ = 0;
     graph::VertexId RegisterStop(const StopOnRoute& stop);
     graph::EdgeId StoreLink(const TwoStopsLink& link, graph::EdgeId edge);
     graph::VertexId GetStopVertexId(std::string_view stop_name) const;
+    // Только при построении графа: вершины остановок зарегистрированы первыми в порядке id, поэтому номер вершины равен id - 1
+    static graph::VertexId GetBuildStopVertexId(const transport::Stop* stop);
     TwoStopsLink DeserializeTwoStopsLink(const tc_serialize::TwoStopsLinkPB& link) const;
     tc_serialize::StopOnRoutePB SerializeStopOnRoute(const StopOnRoute& stop, graph::VertexId vertexId) const;
     StopOnRoute DeserializeStopOnRoute(const tc_serialize::StopOnRoutePB& stop);
     void FillWithReturnRouteStops(const transport::BusRoute* bus_route);
     void FillWithCircleRouteStops(const transport::BusRoute* bus_route);
+    void RegisterRideVertices(const transport::BusRoute* bus_route);
+    void FillWithRideEdges(const transport::BusRoute* bus_route);
+    template <typename StopIt>
+    void FillRideChain(std::string_view bus_name, StopIt begin, StopIt end, size_t first_position);
+    void FreezeGraph();
     double CalculateTimeForDistance(int distance) const;
+    double CalculateWalkTime(double distance) const;
     static tc_serialize::TwoStopsLinkPB SerializeTwoStopsLink(const TwoStopsLink& link, graph::EdgeId edge) ;
     static tc_serialize::EdgePB SerializeEdge(const graph::Edge<double>& edge) ;
     static graph::Edge<double> DeserializeEdge(const tc_serialize::EdgePB& edge) ;
-    static tc_serialize::IncListPB SerializeIncList(const std::vector<size_t>& list) ;
-    static std::vector<size_t> DeserializeIncList(const tc_serialize::IncListPB& list) ;
 };
\ No newline at end of file